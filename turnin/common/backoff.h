@@ -0,0 +1,55 @@
+// Copyright 2024 Blaise Tine
+//
+// Licensed under the Apache License;
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstdint>
+#include <chrono>
+#include <thread>
+
+// Bounded backoff for a thread polling a lock-free queue: retry at once for
+// a short while, then yield the host core, then sleep for doubling periods
+// up to a cap, so a side that waits for long does not hold a host core.
+class Backoff {
+public:
+  Backoff() : count_(0), sleep_us_(1) {}
+
+  void wait() {
+    if (count_ < SPIN_LIMIT) {
+      ++count_;
+    } else if (count_ < YIELD_LIMIT) {
+      ++count_;
+      std::this_thread::yield();
+    } else {
+      std::this_thread::sleep_for(std::chrono::microseconds(sleep_us_));
+      if (sleep_us_ < SLEEP_LIMIT_US) {
+        sleep_us_ *= 2;
+      }
+    }
+  }
+
+  void reset() {
+    count_ = 0;
+    sleep_us_ = 1;
+  }
+
+private:
+  enum {
+    SPIN_LIMIT     = 64,
+    YIELD_LIMIT    = 128,
+    SLEEP_LIMIT_US = 256,
+  };
+
+  uint32_t count_;
+  uint32_t sleep_us_;
+};
@@ -24,6 +24,10 @@ constexpr uint32_t count_trailing_zeros(uint32_t value) {
   return value ? __builtin_ctz(value) : 32;
 }
 
+constexpr uint32_t count_trailing_zeros(uint64_t value) {
+  return value ? __builtin_ctzll(value) : 64;
+}
+
 constexpr bool ispow2(uint32_t value) {
   return value && !(value & (value - 1));
 }
@@ -16,6 +16,9 @@
 #include <iostream>
 #include <fstream>
 #include <assert.h>
+#include <string.h>
+#include <algorithm>
+#include <sys/mman.h>
 #include "util.h"
 
 using namespace tinyrv;
@@ -85,6 +88,31 @@ void RomMemDevice::write(const void* /*data*/, uint64_t /*addr*/, uint64_t /*siz
 bool MemoryUnit::ADecoder::lookup(uint64_t addr, uint32_t wordSize, mem_accessor_t* ma) {
   uint64_t end = addr + (wordSize - 1);
   assert(end >= addr);
+  if (segments_.empty())
+    return false;
+  // check the last hit segment, then binary search
+  auto seg = &segments_[last_hit_];
+  if (addr < seg->start || addr > seg->end) {
+    auto iter = std::upper_bound(segments_.begin(), segments_.end(), addr, 
+      [](uint64_t a, const segment_t& s) { return a < s.start; });
+    if (iter == segments_.begin())
+      return this->lookup_slow(addr, end, ma);
+    seg = &*(--iter);
+    if (addr > seg->end)
+      return this->lookup_slow(addr, end, ma);
+    last_hit_ = seg - segments_.data();
+  }
+  auto& entry = entries_[seg->entry];
+  if (end > entry.end) {
+    // the access leaves the top device, a lower one may still cover it
+    return this->lookup_slow(addr, end, ma);
+  }
+  ma->md   = entry.md;
+  ma->addr = addr - entry.start;
+  return true;
+}
+
+bool MemoryUnit::ADecoder::lookup_slow(uint64_t addr, uint64_t end, mem_accessor_t* ma) {
   for (auto iter = entries_.rbegin(), iterE = entries_.rend(); iter != iterE; ++iter) {
     if (addr >= iter->start && end <= iter->end) {
       ma->md   = iter->md;
@@ -99,6 +127,36 @@ void MemoryUnit::ADecoder::map(uint64_t start, uint64_t end, MemDevice &md) {
   assert(end >= start);
   entry_t entry{&md, start, end};
   entries_.emplace_back(entry);
+
+  // rebuild the segment index, later mappings take priority
+  std::vector<uint64_t> bounds;
+  for (auto& e : entries_) {
+    bounds.push_back(e.start);
+    if (e.end != UINT64_MAX) {
+      bounds.push_back(e.end + 1);
+    }
+  }
+  std::sort(bounds.begin(), bounds.end());
+  bounds.erase(std::unique(bounds.begin(), bounds.end()), bounds.end());
+  segments_.clear();
+  for (size_t i = 0; i < bounds.size(); ++i) {
+    uint64_t seg_start = bounds[i];
+    uint64_t seg_end = (i + 1 < bounds.size()) ? (bounds[i + 1] - 1) : UINT64_MAX;
+    for (size_t j = entries_.size(); j-- != 0;) {
+      auto& e = entries_[j];
+      if (seg_start >= e.start && seg_start <= e.end) {
+        if (!segments_.empty() 
+         && segments_.back().entry == j
+         && segments_.back().end + 1 == seg_start) {
+          segments_.back().end = std::min(seg_end, e.end);
+        } else {
+          segments_.push_back({seg_start, std::min(seg_end, e.end), uint32_t(j)});
+        }
+        break;
+      }
+    }
+  }
+  last_hit_ = 0;
 }
 
 void MemoryUnit::ADecoder::read(void* data, uint64_t addr, uint64_t size) {
@@ -190,72 +248,193 @@ void MemoryUnit::tlbRm(uint64_t va) {
 
 ///////////////////////////////////////////////////////////////////////////////
 
-RAM::RAM(uint32_t page_size, uint64_t capacity) 
+RAM::RAM(uint32_t page_size, uint64_t capacity, bool sparse) 
   : capacity_(capacity)
   , page_bits_(log2ceil(page_size))
-  , last_page_(nullptr)
-  , last_page_index_(0) {    
+  , l2_bits_((ADDR_BITS - page_bits_) / 2)
+  , page_table_(1 << (ADDR_BITS - page_bits_ - l2_bits_), nullptr)
+  , num_pages_(0)
+  , base_(nullptr)
+  , base_size_(0) {    
    assert(ispow2(page_size));
    assert(0 == capacity || ispow2(capacity));
    assert(0 == (capacity % page_size));
+   assert(page_bits_ < ADDR_BITS);
+  if (sparse) {
+    // reserve the guest space without committing host memory
+    base_size_ = capacity ? capacity : (uint64_t(1) << ADDR_BITS);
+    void* ptr = mmap(nullptr, base_size_, PROT_READ | PROT_WRITE, 
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (ptr == MAP_FAILED) {
+      std::cout << "warning: sparse memory reservation failed, using the page table." << std::endl;
+      base_size_ = 0;
+    } else {
+    #ifdef MADV_HUGEPAGE
+      madvise(ptr, base_size_, MADV_HUGEPAGE);
+    #endif
+      base_ = (uint8_t*)ptr;
+      touched_.resize(((base_size_ >> page_bits_) + 63) / 64, 0);
+    }
+  }
 }
 
 RAM::~RAM() {
   this->clear();
+  if (base_) {
+    munmap(base_, base_size_);
+  }
 }
 
 void RAM::clear() {
-  for (auto& page : pages_) {
-    delete[] page.second;
+  if (base_) {
+    // release the host pages, they read back as zero until touched again
+    madvise(base_, base_size_, MADV_DONTNEED);
+    std::fill(touched_.begin(), touched_.end(), 0);
+    num_pages_ = 0;
+    return;
+  }
+  for (auto& l2 : page_table_) {
+    delete[] l2;
+    l2 = nullptr;
   }
+  num_pages_ = 0;
 }
 
 uint64_t RAM::size() const {
-  return uint64_t(pages_.size()) << page_bits_;
+  return num_pages_ << page_bits_;
+}
+
+void RAM::fill_page(uint8_t* ptr) const {
+  uint32_t page_size = 1 << page_bits_;
+  // set uninitialized data to "baadf00d"
+  for (uint32_t i = 0; i < page_size; ++i) {
+    ptr[i] = (0xbaadf00d >> ((i & 0x3) * 8)) & 0xff;
+  }
+  ++num_pages_;
+}
+
+RAM::page_ptr RAM::alloc_page() const {
+  return page_ptr(new uint8_t[1 << page_bits_], std::default_delete<uint8_t[]>());
 }
 
-uint8_t *RAM::get(uint64_t address) const {
-  if (capacity_ != 0 && address >= capacity_) {
+uint8_t *RAM::get(uint64_t address, bool write) const {
+  if ((capacity_ != 0 && address >= capacity_)
+   || (address >> ADDR_BITS) != 0) {
     throw OutOfRange();
   }
   uint32_t page_size   = 1 << page_bits_;  
   uint32_t page_offset = address & (page_size - 1);
   uint64_t page_index  = address >> page_bits_;
 
-  uint8_t* page;
-  if (last_page_ && last_page_index_ == page_index) {
-    page = last_page_;
-  } else {
-    auto it = pages_.find(page_index);
-    if (it != pages_.end()) {
-      page = it->second;
-    } else {
-      uint8_t *ptr = new uint8_t[page_size];
-      // set uninitialized data to "baadf00d"
-      for (uint32_t i = 0; i < page_size; ++i) {
-        ptr[i] = (0xbaadf00d >> ((i & 0x3) * 8)) & 0xff;
+  if (base_) {
+    auto& bits = touched_[page_index / 64];
+    uint64_t mask = uint64_t(1) << (page_index % 64);
+    if (0 == (bits & mask)) {
+      this->fill_page(base_ + (address - page_offset));
+      bits |= mask;
+    }
+    return base_ + address;
+  }
+
+  auto& l2 = page_table_[page_index >> l2_bits_];
+  if (l2 == nullptr) {
+    l2 = new page_ptr[1 << l2_bits_];
+  }
+  auto& page = l2[page_index & ((1 << l2_bits_) - 1)];
+  if (page == nullptr) {
+    page = this->alloc_page();
+    this->fill_page(page.get());
+  } else if (write && page.use_count() > 1) {
+    // the page is shared with a snapshot, copy it before writing
+    auto copy = this->alloc_page();
+    memcpy(copy.get(), page.get(), page_size);
+    page = copy;
+  }
+
+  return page.get() + page_offset;
+}
+
+void RAM::snapshot(snapshot_t* snapshot) const {
+  uint32_t page_size = 1 << page_bits_;
+  snapshot->pages.clear();
+  if (base_) {
+    // the sparse backend cannot share host pages, copy the touched ones
+    for (uint64_t i = 0, n = touched_.size() * 64; i < n; ++i) {
+      if (touched_[i / 64] & (uint64_t(1) << (i % 64))) {
+        auto page = this->alloc_page();
+        memcpy(page.get(), base_ + (i << page_bits_), page_size);
+        snapshot->pages.emplace_back(i, page);
+      }
+    }
+    return;
+  }
+  uint32_t l2_size = 1 << l2_bits_;
+  for (uint64_t i = 0; i < page_table_.size(); ++i) {
+    auto l2 = page_table_[i];
+    if (l2 == nullptr)
+      continue;
+    for (uint32_t j = 0; j < l2_size; ++j) {
+      if (l2[j]) {
+        snapshot->pages.emplace_back((i << l2_bits_) | j, l2[j]);
       }
-      pages_.emplace(page_index, ptr);
-      page = ptr;
     }
-    last_page_ = page;
-    last_page_index_ = page_index;
   }
+}
 
-  return page + page_offset;
+void RAM::restore(const snapshot_t& snapshot) {
+  uint32_t page_size = 1 << page_bits_;
+  this->clear();
+  for (auto& entry : snapshot.pages) {
+    auto page_index = entry.first;
+    if (base_) {
+      memcpy(base_ + (page_index << page_bits_), entry.second.get(), page_size);
+      touched_[page_index / 64] |= uint64_t(1) << (page_index % 64);
+    } else {
+      auto& l2 = page_table_[page_index >> l2_bits_];
+      if (l2 == nullptr) {
+        l2 = new page_ptr[1 << l2_bits_];
+      }
+      l2[page_index & ((1 << l2_bits_) - 1)] = entry.second;
+    }
+  }
+  num_pages_ = snapshot.pages.size();
 }
 
 void RAM::read(void* data, uint64_t addr, uint64_t size) {
   uint8_t* d = (uint8_t*)data;
-  for (uint64_t i = 0; i < size; i++) {
-    d[i] = *this->get(addr + i);
+  uint64_t page_size = uint64_t(1) << page_bits_;
+  uint64_t offset = addr & (page_size - 1);
+  if (offset + size <= page_size) {
+    // single page access
+    memcpy(d, this->get(addr, false), size);
+    return;
+  }
+  // split at page boundaries
+  while (size != 0) {
+    uint64_t chunk = std::min(size, page_size - (addr & (page_size - 1)));
+    memcpy(d, this->get(addr, false), chunk);
+    d += chunk;
+    addr += chunk;
+    size -= chunk;
   }
 }
 
 void RAM::write(const void* data, uint64_t addr, uint64_t size) {
   const uint8_t* d = (const uint8_t*)data;
-  for (uint64_t i = 0; i < size; i++) {
-    *this->get(addr + i) = d[i];
+  uint64_t page_size = uint64_t(1) << page_bits_;
+  uint64_t offset = addr & (page_size - 1);
+  if (offset + size <= page_size) {
+    // single page access
+    memcpy(this->get(addr, true), d, size);
+    return;
+  }
+  // split at page boundaries
+  while (size != 0) {
+    uint64_t chunk = std::min(size, page_size - (addr & (page_size - 1)));
+    memcpy(this->get(addr, true), d, chunk);
+    d += chunk;
+    addr += chunk;
+    size -= chunk;
   }
 }
 
@@ -316,13 +495,14 @@ void RAM::loadHexImage(const char* filename) {
       uint32_t nextAddr = hToI(line + 3, 4) + offset;
       uint32_t key = hToI(line + 7, 2);
       switch (key) {
-      case 0:
+      case 0: {
+        uint8_t data[256];
         for (uint32_t i = 0; i < byteCount; i++) {
-          uint32_t addr  = nextAddr + i;
-          uint32_t value = hToI(line + 9 + i * 2, 2);
-          *this->get(addr) = value;
+          data[i] = hToI(line + 9 + i * 2, 2);
         }
+        this->write(data, nextAddr, byteCount);
         break;
+      }
       case 2:
         offset = hToI(line + 9, 4) << 4;
         break;
@@ -16,6 +16,7 @@
 #include <cstdint>
 #include <vector>
 #include <unordered_map>
+#include <memory>
 #include <cstdint>
 
 namespace tinyrv {
@@ -106,7 +107,7 @@ private:
 
   class ADecoder {
   public:
-    ADecoder() {}
+    ADecoder() : last_hit_(0) {}
     
     void read(void* data, uint64_t addr, uint64_t size);
     void write(const void* data, uint64_t addr, uint64_t size);
@@ -126,9 +127,20 @@ private:
       uint64_t    end;        
     };
 
+    // address range resolved to the most recently mapped device covering it
+    struct segment_t {
+      uint64_t    start;
+      uint64_t    end;
+      uint32_t    entry;
+    };
+
     bool lookup(uint64_t addr, uint32_t wordSize, mem_accessor_t*);
 
+    bool lookup_slow(uint64_t addr, uint64_t end, mem_accessor_t*);
+
     std::vector<entry_t> entries_;
+    std::vector<segment_t> segments_;
+    uint32_t last_hit_;
   };
 
   struct TLBEntry {
@@ -157,8 +169,15 @@ private:
 
 class RAM : public MemDevice {
 public:
+
+  typedef std::shared_ptr<uint8_t> page_ptr;
+
+  // memory image, pages are shared copy-on-write with the RAM
+  struct snapshot_t {
+    std::vector<std::pair<uint64_t, page_ptr>> pages;
+  };
   
-   RAM(uint32_t page_size, uint64_t capacity = 0);
+   RAM(uint32_t page_size, uint64_t capacity = 0, bool sparse = false);
   ~RAM();
 
   void clear();
@@ -171,23 +190,39 @@ public:
   void loadBinImage(const char* filename, uint64_t destination);
   void loadHexImage(const char* filename);
 
+  void snapshot(snapshot_t* snapshot) const;
+  void restore(const snapshot_t& snapshot);
+
   uint8_t& operator[](uint64_t address) {
-    return *this->get(address);
+    return *this->get(address, true);
   }
 
   const uint8_t& operator[](uint64_t address) const {
-    return *this->get(address);
+    return *this->get(address, false);
   }
 
 private:
 
-  uint8_t *get(uint64_t address) const;
+  // guest address space covered by the page table
+  static const uint32_t ADDR_BITS = 32;
+
+  uint8_t *get(uint64_t address, bool write) const;
+
+  page_ptr alloc_page() const;
+
+  void fill_page(uint8_t* ptr) const;
 
   uint64_t capacity_;
-  uint32_t page_bits_;  
-  mutable std::unordered_map<uint64_t, uint8_t*> pages_;
-  mutable uint8_t* last_page_;
-  mutable uint64_t last_page_index_;
+  uint32_t page_bits_;
+  uint32_t l2_bits_;
+  // two-level page table, allocated lazily
+  mutable std::vector<page_ptr*> page_table_;
+  mutable uint64_t num_pages_;
+  // sparse backend: one host mapping of the whole guest space,
+  // pages get their initial pattern on first touch
+  uint8_t* base_;
+  uint64_t base_size_;
+  mutable std::vector<uint64_t> touched_;
 };
 
 } // namespace tinyrv
@@ -13,50 +13,73 @@
 
 #pragma once
 
-#include <stack>
+#include <cstdint>
+#include <vector>
+#include <type_traits>
 
+// Slab allocator for fixed-size objects of type T.
+// Released objects are kept on an intrusive free list,
+// so steady-state allocation never reaches the host heap.
 template <typename T>
 class MemoryPool {
 public:  
-  MemoryPool(uint32_t max_size) : max_size_(max_size) {}
+  MemoryPool(uint32_t slab_size = 64) 
+    : slab_size_(slab_size)
+    , free_list_(nullptr)
+  {}
 
   MemoryPool(MemoryPool && other) 
-    : free_list_(std::move(other.free_list_)) 
-  {}
+    : slabs_(std::move(other.slabs_))
+    , slab_size_(other.slab_size_)
+    , free_list_(other.free_list_) {
+    other.free_list_ = nullptr;
+  }
 
   ~MemoryPool() {
     this->flush();
   }
 
   void* allocate() {
-    void* mem;
-    if (!free_list_.empty()) {
-      auto entry = free_list_.top();
-      free_list_.pop();
-      mem = static_cast<void*>(entry);      
-    } else {
-      mem = ::operator new(sizeof(T));
+    if (free_list_ == nullptr) {
+      this->grow();
     }
-    return mem;
+    auto node = free_list_;
+    free_list_ = node->next;
+    return static_cast<void*>(node);
   }
 
   void deallocate(void * object) {
-    if (free_list_.size() < max_size_) {
-      free_list_.push(static_cast<T*>(object));
-    } else {
-      ::operator delete(object);
-    }
+    auto node = static_cast<node_t*>(object);
+    node->next = free_list_;
+    free_list_ = node;
   }
 
+  // release all slabs, all objects must have been deallocated
   void flush() {
-    while (!free_list_.empty()) {
-      auto entry = free_list_.top();
-      free_list_.pop();
-      ::operator delete(entry);      
+    for (auto slab : slabs_) {
+      ::operator delete(slab);
     }
+    slabs_.clear();
+    free_list_ = nullptr;
   }
 
 private:
-  std::stack<T*> free_list_;
-  uint32_t max_size_;
+
+  union node_t {
+    node_t* next;
+    typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+  };
+
+  void grow() {
+    auto slab = static_cast<node_t*>(::operator new(sizeof(node_t) * slab_size_));
+    slabs_.push_back(slab);
+    for (uint32_t i = slab_size_; i-- != 0;) {
+      slab[i].next = free_list_;
+      free_list_ = &slab[i];
+    }
+  }
+
+  std::vector<node_t*> slabs_;
+  uint32_t slab_size_;
+  node_t*  free_list_;
 };
@@ -0,0 +1,109 @@
+// Copyright 2024 Blaise Tine
+//
+// Licensed under the Apache License;
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <utility>
+#include <assert.h>
+#include "bitmanip.h"
+
+// FIFO queue over a power-of-two circular store.
+// The store doubles when full and is never shrunk,
+// so a warmed-up queue does not allocate.
+template <typename T>
+class RingBuffer {
+public:
+  RingBuffer(uint32_t capacity = 16)
+    : store_(1u << log2ceil(capacity < 2 ? 2 : capacity))
+    , mask_(store_.size() - 1)
+    , head_(0)
+    , size_(0)
+  {}
+
+  bool empty() const {
+    return (0 == size_);
+  }
+
+  bool full() const {
+    return (size_ == store_.size());
+  }
+
+  uint32_t size() const {
+    return size_;
+  }
+
+  uint32_t capacity() const {
+    return store_.size();
+  }
+
+  T& front() {
+    assert(!this->empty());
+    return store_[head_];
+  }
+
+  const T& front() const {
+    assert(!this->empty());
+    return store_[head_];
+  }
+
+  T& back() {
+    assert(!this->empty());
+    return store_[(head_ + size_ - 1) & mask_];
+  }
+
+  const T& back() const {
+    assert(!this->empty());
+    return store_[(head_ + size_ - 1) & mask_];
+  }
+
+  void push(const T& value) {
+    if (this->full()) {
+      this->grow();
+    }
+    store_[(head_ + size_) & mask_] = value;
+    ++size_;
+  }
+
+  void pop() {
+    assert(!this->empty());
+    store_[head_] = T();
+    head_ = (head_ + 1) & mask_;
+    --size_;
+  }
+
+  void clear() {
+    while (!this->empty()) {
+      this->pop();
+    }
+    head_ = 0;
+  }
+
+private:
+
+  void grow() {
+    std::vector<T> store(store_.size() * 2);
+    for (uint32_t i = 0; i < size_; ++i) {
+      store[i] = std::move(store_[(head_ + i) & mask_]);
+    }
+    store_.swap(store);
+    mask_ = store_.size() - 1;
+    head_ = 0;
+  }
+
+  std::vector<T> store_;
+  uint32_t mask_;
+  uint32_t head_;
+  uint32_t size_;
+};
@@ -14,13 +14,16 @@
 #pragma once
 
 #include <functional>
+#include <algorithm>
 #include <iostream>
 #include <memory>
 #include <vector>
 #include <list>
 #include <queue>
 #include <assert.h>
+#include <stdint.h>
 #include "mempool.h"
+#include "ringbuffer.h"
 
 class SimObjectBase;
 
@@ -81,7 +84,7 @@ public:
   }
 
   const Pkt& front() const {
-    return queue_.front();
+    return queue_.front().pkt;
   }
 
   Pkt& front() {
@@ -89,7 +92,7 @@ public:
   }
 
   const Pkt& back() const {
-    return queue_.back();
+    return queue_.back().pkt;
   }
 
   Pkt& back() {
@@ -102,6 +105,10 @@ public:
     return cycles;
   }  
 
+  void clear() {
+    queue_.clear();
+  }
+
   void tx_callback(const TxCallback& callback) {
     tx_cb_ = callback;
   }
@@ -118,7 +125,7 @@ protected:
     uint64_t cycles;
   };
 
-  std::queue<timed_pkt_t> queue_;
+  RingBuffer<timed_pkt_t> queue_;
   SimPort*   peer_;
   TxCallback tx_cb_;
 
@@ -142,8 +149,6 @@ protected:
 
 class SimEventBase {
 public:
-  typedef std::shared_ptr<SimEventBase> Ptr;
-
   virtual ~SimEventBase() {}
   
   virtual void fire() const = 0;
@@ -153,22 +158,30 @@ public:
   }
 
 protected:
-  SimEventBase(uint64_t cycles) : cycles_(cycles) {}
+  SimEventBase(uint64_t cycles) 
+    : cycles_(cycles)
+    , seq_(0)
+    , next_(nullptr) 
+  {}
 
   uint64_t cycles_;
+
+private:
+  uint64_t      seq_;
+  SimEventBase* next_;
+
+  friend class SimEventQueue;
 };
 
 ///////////////////////////////////////////////////////////////////////////////
 
-template <typename Pkt>
+template <typename Pkt, typename Func>
 class SimCallEvent : public SimEventBase {
 public:
   void fire() const override {
     func_(pkt_);
   }
 
-  typedef std::function<void (const Pkt&)> Func;
-
   SimCallEvent(const Func& func, const Pkt& pkt, uint64_t cycles) 
     : SimEventBase(cycles)
     , func_(func)
@@ -187,8 +200,8 @@ protected:
   Func func_;
   Pkt  pkt_;
 
-  static MemoryPool<SimCallEvent<Pkt>>& allocator() {
-    static MemoryPool<SimCallEvent<Pkt>> instance(64);
+  static MemoryPool<SimCallEvent>& allocator() {
+    static thread_local MemoryPool<SimCallEvent> instance(64);
     return instance;
   }
 };
@@ -221,14 +234,146 @@ protected:
   Pkt pkt_;
 
   static MemoryPool<SimPortEvent<Pkt>>& allocator() {
-    static MemoryPool<SimPortEvent<Pkt>> instance(64);
+    static thread_local MemoryPool<SimPortEvent<Pkt>> instance(64);
     return instance;
   }
 };
 
 ///////////////////////////////////////////////////////////////////////////////
 
+// Timing wheel holding the pending events indexed by their due cycle.
+// Events due within the wheel window are linked into the bucket of their
+// cycle, far-future events are kept in an overflow heap. Events due on the
+// same cycle fire in scheduling order. The queue owns its events and
+// deletes them once fired.
+class SimEventQueue {
+public:
+  SimEventQueue(uint32_t wheel_size = 256)
+    : wheel_(wheel_size)
+    , mask_(wheel_size - 1)
+    , next_seq_(0)
+    , size_(0) {
+    assert(0 == (wheel_size & mask_));
+  }
+
+  ~SimEventQueue() {
+    this->clear();
+  }
+
+  void push(SimEventBase* evt, uint64_t cycles) {
+    assert(evt->cycles() > cycles);
+    evt->seq_ = next_seq_++;
+    evt->next_ = nullptr;
+    if ((evt->cycles() - cycles) < wheel_.size()) {
+      auto& bucket = wheel_[evt->cycles() & mask_];
+      if (bucket.tail) {
+        bucket.tail->next_ = evt;
+      } else {
+        bucket.head = evt;
+      }
+      bucket.tail = evt;
+    } else {
+      overflow_.push_back(evt);
+      std::push_heap(overflow_.begin(), overflow_.end(), evt_cmp_t());
+    }
+    ++size_;
+  }
+
+  // fire all events due at the given cycle
+  void fire(uint64_t cycles) {
+    auto& bucket = wheel_[cycles & mask_];
+    auto head = bucket.head;
+    bucket.head = nullptr;
+    bucket.tail = nullptr;
+    for (;;) {
+      bool overflow_due = !overflow_.empty()
+                       && overflow_.front()->cycles() <= cycles;
+      SimEventBase* evt;
+      if (head && !(overflow_due && overflow_.front()->seq_ < head->seq_)) {
+        evt = head;
+        head = head->next_;
+      } else if (overflow_due) {
+        evt = overflow_.front();
+        std::pop_heap(overflow_.begin(), overflow_.end(), evt_cmp_t());
+        overflow_.pop_back();
+      } else {
+        break;
+      }
+      --size_;
+      evt->fire();
+      delete evt;
+    }
+  }
+
+  void clear() {
+    for (auto& bucket : wheel_) {
+      auto evt = bucket.head;
+      while (evt) {
+        auto next = evt->next_;
+        delete evt;
+        evt = next;
+      }
+      bucket.head = nullptr;
+      bucket.tail = nullptr;
+    }
+    for (auto evt : overflow_) {
+      delete evt;
+    }
+    overflow_.clear();
+    size_ = 0;
+  }
+
+  bool empty() const {
+    return (0 == size_);
+  }
+
+  size_t size() const {
+    return size_;
+  }
+
+  // return the due cycle of the earliest pending event
+  uint64_t next_cycles(uint64_t cycles) const {
+    assert(!this->empty());
+    uint64_t next = UINT64_MAX;
+    if (!overflow_.empty()) {
+      next = overflow_.front()->cycles();
+    }
+    for (uint64_t i = 0, n = wheel_.size(); i < n && (cycles + i) < next; ++i) {
+      if (wheel_[(cycles + i) & mask_].head) {
+        next = cycles + i;
+        break;
+      }
+    }
+    return next;
+  }
+
+private:
+
+  struct bucket_t {
+    SimEventBase* head;
+    SimEventBase* tail;
+    bucket_t() : head(nullptr), tail(nullptr) {}
+  };
+
+  struct evt_cmp_t {
+    bool operator()(const SimEventBase* lhs, const SimEventBase* rhs) const {
+      if (lhs->cycles() != rhs->cycles())
+        return lhs->cycles() > rhs->cycles();
+      return lhs->seq_ > rhs->seq_;
+    }
+  };
+
+  std::vector<bucket_t> wheel_;
+  std::vector<SimEventBase*> overflow_;
+  uint64_t mask_;
+  uint64_t next_seq_;
+  size_t size_;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
 class SimContext;
+class SimPlatform;
 
 class SimObjectBase {
 public:
@@ -240,6 +385,10 @@ public:
     return name_;
   } 
 
+  SimPlatform& platform() const {
+    return *platform_;
+  }
+
 protected:
 
   SimObjectBase(const SimContext& ctx, const char* name); 
@@ -250,27 +399,43 @@ private:
 
   virtual void do_tick() = 0;
 
+  virtual bool do_idle() const = 0;
+
+  virtual void do_skip(uint64_t cycles) = 0;
+
   std::string name_;
+  SimPlatform* platform_;
 
   friend class SimPlatform;
 };
 
 ///////////////////////////////////////////////////////////////////////////////
 
-template <typename Impl>
-class SimObject : public SimObjectBase {
+// Base is SimObjectBase, or a subclass of it holding the state
+// shared by several Impl variants.
+template <typename Impl, typename Base = SimObjectBase>
+class SimObject : public Base {
 public:
   typedef std::shared_ptr<Impl> Ptr;
 
   template <typename... Args>
-  static Ptr Create(Args&&... args);
+  static Ptr Create(SimPlatform& platform, Args&&... args);
 
 protected:
 
-  SimObject(const SimContext& ctx, const char* name) 
-    : SimObjectBase(ctx, name) 
+  template <typename... Args>
+  SimObject(const SimContext& ctx, const char* name, Args&&... args) 
+    : Base(ctx, name, std::forward<Args>(args)...) 
   {}
 
+  // default quiescence hooks: an object that does not override idle()
+  // is assumed to change state every cycle.
+  bool idle() const {
+    return false;
+  }
+
+  void skip(uint64_t /*cycles*/) {}
+
 private:
 
   const Impl* impl() const {
@@ -288,22 +453,54 @@ private:
   void do_tick() override {
     this->impl()->tick();
   }
+
+  bool do_idle() const override {
+    return this->impl()->idle();
+  }
+
+  void do_skip(uint64_t cycles) override {
+    this->impl()->skip(cycles);
+  }
 };
 
 class SimContext {
 private:    
-  SimContext() {}
+  SimContext(SimPlatform* platform) : platform_(platform) {}
+
+  SimPlatform* platform_;
   
   friend class SimPlatform;
+  friend class SimObjectBase;
 };
 
 ///////////////////////////////////////////////////////////////////////////////
 
+// Simulation context owning the components, the event queue and the clock.
+// Each simulation has its own platform, so independent simulations can run
+// side by side on different host threads.
 class SimPlatform {
 public:
-  static SimPlatform& instance() {
-    static SimPlatform s_inst;
-    return s_inst;
+  SimPlatform() : cycles_(0) {
+    this->make_current();
+  }
+
+  virtual ~SimPlatform() {
+    this->clear();
+    if (current() == this) {
+      current_ref() = nullptr;
+    }
+  }
+
+  SimPlatform(const SimPlatform&) = delete;
+  SimPlatform& operator=(const SimPlatform&) = delete;
+
+  // platform last activated on the calling thread, for trace cycle stamps
+  static SimPlatform* current() {
+    return current_ref();
+  }
+
+  void make_current() {
+    current_ref() = this;
   }
 
   bool initialize() {
@@ -312,12 +509,12 @@ public:
   }
 
   void finalize() {
-    instance().clear();
+    this->clear();
   }
 
   template <typename Impl, typename... Args>
-  typename SimObject<Impl>::Ptr create_object(Args&&... args) {
-    auto obj = std::make_shared<Impl>(SimContext{}, std::forward<Args>(args)...);
+  std::shared_ptr<Impl> create_object(Args&&... args) {
+    auto obj = std::make_shared<Impl>(SimContext(this), std::forward<Args>(args)...);
     objects_.push_back(obj);
     return obj;
   }
@@ -326,13 +523,13 @@ public:
     objects_.remove(object);
   }
 
-  template <typename Pkt>
-  void schedule(const typename SimCallEvent<Pkt>::Func& callback,
+  template <typename Pkt, typename Func>
+  void schedule(const Func& callback,
                 const Pkt& pkt, 
                 uint64_t delay) {    
     assert(delay != 0);
-    auto evt = std::make_shared<SimCallEvent<Pkt>>(callback, pkt, cycles_ + delay);    
-    events_.emplace_back(evt);
+    auto evt = new SimCallEvent<Pkt, Func>(callback, pkt, cycles_ + delay);
+    events_.push(evt, cycles_);
   }
 
   void reset() {
@@ -345,17 +542,7 @@ public:
 
   void tick() {
     // evaluate events
-    auto evt_it = events_.begin();
-    auto evt_it_end = events_.end();
-    while (evt_it != evt_it_end) {
-      auto& event = *evt_it;
-      if (cycles_ >= event->cycles()) {        
-        event->fire();
-        evt_it = events_.erase(evt_it);
-      } else {        
-        ++evt_it;
-      }
-    }
+    events_.fire(cycles_);
     // evaluate components
     for (auto& object : objects_) {
       object->do_tick();
@@ -364,16 +551,35 @@ public:
     ++cycles_;
   }
 
+  // jump over the cycles where no component can change state
+  // before the next pending event fires, returns the skipped cycles.
+  uint64_t fast_forward() {
+    if (events_.empty())
+      return 0;
+    for (auto& object : objects_) {
+      if (!object->do_idle())
+        return 0;
+    }
+    auto next = events_.next_cycles(cycles_);
+    if (next <= cycles_)
+      return 0;
+    auto skipped = next - cycles_;
+    for (auto& object : objects_) {
+      object->do_skip(skipped);
+    }
+    cycles_ = next;
+    return skipped;
+  }
+
   uint64_t cycles() const {
     return cycles_;
   }
 
 private:
 
-  SimPlatform() : cycles_(0) {}
-
-  virtual ~SimPlatform() {
-    this->clear();
+  static SimPlatform*& current_ref() {
+    static thread_local SimPlatform* s_current = nullptr;
+    return s_current;
   }
 
   void clear() {
@@ -384,12 +590,12 @@ private:
   template <typename Pkt>
   void schedule(const SimPort<Pkt>* port, const Pkt& pkt, uint64_t delay) {
     assert(delay != 0);
-    auto evt = SimEventBase::Ptr(new SimPortEvent<Pkt>(port, pkt, cycles_ + delay));
-    events_.emplace_back(evt);
+    auto evt = new SimPortEvent<Pkt>(port, pkt, cycles_ + delay);
+    events_.push(evt, cycles_);
   }
 
   std::list<SimObjectBase::Ptr> objects_;
-  std::list<SimEventBase::Ptr> events_;
+  SimEventQueue events_;
   uint64_t cycles_;
 
   template <typename U> friend class SimPort;
@@ -398,14 +604,15 @@ private:
 
 ///////////////////////////////////////////////////////////////////////////////
 
-inline SimObjectBase::SimObjectBase(const SimContext&, const char* name) 
+inline SimObjectBase::SimObjectBase(const SimContext& ctx, const char* name) 
   : name_(name) 
+  , platform_(ctx.platform_)
 {}
 
-template <typename Impl>
+template <typename Impl, typename Base>
 template <typename... Args>
-typename SimObject<Impl>::Ptr SimObject<Impl>::Create(Args&&... args) {
-  return SimPlatform::instance().create_object<Impl>(std::forward<Args>(args)...);
+typename SimObject<Impl, Base>::Ptr SimObject<Impl, Base>::Create(SimPlatform& platform, Args&&... args) {
+  return platform.create_object<Impl>(std::forward<Args>(args)...);
 }
 
 template <typename Pkt>
@@ -413,6 +620,6 @@ void SimPort<Pkt>::send(const Pkt& pkt, uint64_t delay) const {
   if (peer_ && !tx_cb_) {
     reinterpret_cast<const SimPort<Pkt>*>(peer_)->send(pkt, delay);    
   } else {
-    SimPlatform::instance().schedule(this, pkt, delay);
+    module_->platform().schedule(this, pkt, delay);
   } 
 }
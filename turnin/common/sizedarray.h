@@ -0,0 +1,91 @@
+// Copyright 2024 Blaise Tine
+//
+// Licensed under the Apache License;
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstdint>
+#include <array>
+#include <vector>
+#include <algorithm>
+#include <assert.h>
+
+// Array of N elements stored inline, with a size the compiler can fold.
+// N = 0 selects a heap array sized at construction instead.
+template <typename T, uint32_t N>
+class SizedArray {
+public:
+  SizedArray(uint32_t size) {
+    assert(size == N);
+    (void)size;
+  }
+
+  SizedArray(uint32_t size, const T& value) : SizedArray(size) {
+    data_.fill(value);
+  }
+
+  static constexpr uint32_t size() {
+    return N;
+  }
+
+  T& operator[](uint32_t index) {
+    return data_[index];
+  }
+
+  const T& operator[](uint32_t index) const {
+    return data_[index];
+  }
+
+  void fill(const T& value) {
+    data_.fill(value);
+  }
+
+  T* begin() { return data_.data(); }
+  T* end() { return data_.data() + N; }
+  const T* begin() const { return data_.data(); }
+  const T* end() const { return data_.data() + N; }
+
+private:
+  std::array<T, N> data_;
+};
+
+template <typename T>
+class SizedArray<T, 0> {
+public:
+  SizedArray(uint32_t size) : data_(size) {}
+
+  SizedArray(uint32_t size, const T& value) : data_(size, value) {}
+
+  uint32_t size() const {
+    return data_.size();
+  }
+
+  T& operator[](uint32_t index) {
+    return data_[index];
+  }
+
+  const T& operator[](uint32_t index) const {
+    return data_[index];
+  }
+
+  void fill(const T& value) {
+    std::fill(data_.begin(), data_.end(), value);
+  }
+
+  T* begin() { return data_.data(); }
+  T* end() { return data_.data() + data_.size(); }
+  const T* begin() const { return data_.data(); }
+  const T* end() const { return data_.data() + data_.size(); }
+
+private:
+  std::vector<T> data_;
+};
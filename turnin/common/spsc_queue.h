@@ -0,0 +1,70 @@
+// Copyright 2024 Blaise Tine
+//
+// Licensed under the Apache License;
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstdint>
+#include <atomic>
+#include <vector>
+#include "bitmanip.h"
+
+// Bounded lock-free queue for one producer thread and one consumer thread.
+// Each index is written by one side only; acquire/release ordering on the
+// indices publishes the slot contents to the other side.
+template <typename T>
+class SPSCQueue {
+public:
+  SPSCQueue(uint32_t capacity = 1024)
+    : store_(1u << log2ceil(capacity < 2 ? 2 : capacity))
+    , mask_(store_.size() - 1)
+    , head_(0)
+    , tail_(0)
+  {}
+
+  uint32_t capacity() const {
+    return store_.size();
+  }
+
+  // producer side
+  bool try_push(const T& value) {
+    auto tail = tail_.load(std::memory_order_relaxed);
+    if (tail - head_.load(std::memory_order_acquire) == store_.size())
+      return false;
+    store_[tail & mask_] = value;
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // consumer side
+  bool try_pop(T* value) {
+    auto head = head_.load(std::memory_order_relaxed);
+    if (head == tail_.load(std::memory_order_acquire))
+      return false;
+    *value = store_[head & mask_];
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  // drop all entries, neither side may be in use
+  void clear() {
+    head_.store(0, std::memory_order_relaxed);
+    tail_.store(0, std::memory_order_relaxed);
+  }
+
+private:
+  std::vector<T> store_;
+  uint32_t mask_;
+  // keep the indices on separate cache lines
+  alignas(64) std::atomic<uint32_t> head_;
+  alignas(64) std::atomic<uint32_t> tail_;
+};
@@ -13,6 +13,8 @@
 
 #include "util.h"
 #include <string.h>
+#include <stdlib.h>
+#include <new>
 
 // return file extension
 const char* fileExtension(const char* filepath) {
@@ -36,4 +38,47 @@ void aligned_free(void *ptr) {
   // retreive the stored unaligned address and use it to free the allocation
   void* unaligned_addr = ((void**)ptr)[-1];
   free(unaligned_addr);
-}
\ No newline at end of file
+}
+
+static uint64_t& heap_allocs_ref() {
+  static thread_local uint64_t s_count = 0;
+  return s_count;
+}
+
+uint64_t heap_allocs() {
+  return heap_allocs_ref();
+}
+
+#ifndef NDEBUG
+
+// count the allocations to check that the simulation loop does not allocate
+
+void* operator new(size_t size) {
+  ++heap_allocs_ref();
+  void* ptr = malloc(size ? size : 1);
+  if (ptr == nullptr)
+    throw std::bad_alloc();
+  return ptr;
+}
+
+void* operator new[](size_t size) {
+  return ::operator new(size);
+}
+
+void operator delete(void* ptr) noexcept {
+  free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+  free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+  free(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept {
+  free(ptr);
+}
+
+#endif
@@ -26,6 +26,10 @@ void unused(Args&&...) {}
 // return file extension
 const char* fileExtension(const char* filepath);
 
+// number of heap allocations made by the calling thread,
+// counted in debug builds only
+uint64_t heap_allocs();
+
 #if defined(_MSC_VER)
 #define DISABLE_WARNING_PUSH __pragma(warning(push))
 #define DISABLE_WARNING_POP __pragma(warning(pop))
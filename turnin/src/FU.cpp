@@ -33,7 +33,8 @@ FunctionalUnit::~FunctionalUnit() {
 }
 
 void FunctionalUnit::reset() {
-  //--
+  Input.clear();
+  Output.clear();
 }
 
 void FunctionalUnit::tick() {
@@ -42,4 +43,8 @@ void FunctionalUnit::tick() {
   auto trace = Input.front();
   Output.send(trace, latency_);
   Input.pop();
+}
+
+bool FunctionalUnit::idle() const {
+  return Input.empty();
 }
\ No newline at end of file
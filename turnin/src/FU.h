@@ -38,6 +38,8 @@ public:
 
   void tick();
 
+  bool idle() const;
+
 private:
 
   uint32_t latency_;
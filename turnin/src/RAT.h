@@ -12,20 +12,27 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
-#include <vector>
+#pragma once
+
+#include <array>
+#include "config.h"
 
 namespace tinyrv {
 
 class RegisterAliasTable {
 public:
-  RegisterAliasTable(uint32_t size) : store_(size) {
+  RegisterAliasTable() {
+    this->clear();
+  }
+
+  ~RegisterAliasTable() {}
+
+  void clear() {
     for (auto& entry : store_) {
       entry = -1;
     }
   }
 
-  ~RegisterAliasTable() {}
-
   int get(int index) const {
     return store_[index];
   }
@@ -35,7 +42,7 @@ public:
   }
 
 private:
-  std::vector<int> store_;
+  std::array<int, NUM_REGS> store_;
 };
 
 }
\ No newline at end of file
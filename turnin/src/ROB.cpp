@@ -2,26 +2,29 @@
 #include <assert.h>
 #include <util.h>
 #include "types.h"
-#include "scoreboard.h"
+#include "trace.h"
 #include "debug.h"
 #include "ROB.h"
 
 using namespace tinyrv;
 
-ReorderBuffer::ReorderBuffer(const SimContext& ctx, Scoreboard* scoreboard, uint32_t size) 
-  : SimObject<ReorderBuffer>(ctx, "ReorderBuffer")
+template <uint32_t Size>
+ReorderBuffer<Size>::ReorderBuffer(const SimContext& ctx, RegisterAliasTable* RAT, uint32_t size) 
+  : SimObject<ReorderBuffer<Size>>(ctx, "ReorderBuffer")
   , Completed(this)
   , Committed(this)
-  , scoreboard_(scoreboard)
+  , RAT_(RAT)
   , store_(size) {
   this->reset();
 }
 
-ReorderBuffer::~ReorderBuffer() {
+template <uint32_t Size>
+ReorderBuffer<Size>::~ReorderBuffer() {
   //--
 }
 
-void ReorderBuffer::reset() {
+template <uint32_t Size>
+void ReorderBuffer<Size>::reset() {
   for (auto& entry : store_) {
     entry.trace = nullptr;
     entry.completed = false;
@@ -31,11 +34,12 @@ void ReorderBuffer::reset() {
   count_ = 0;
 }
 
-void ReorderBuffer::tick() {
+template <uint32_t Size>
+void ReorderBuffer<Size>::tick() {
   if (this->is_empty())
     return;
 
-  auto& RAT = scoreboard_->RAT_;
+  auto& RAT = *RAT_;
   
   //TODO:
 
@@ -64,7 +68,13 @@ void ReorderBuffer::tick() {
   }
 }
 
-int ReorderBuffer::allocate(pipeline_trace_t* trace) {
+template <uint32_t Size>
+bool ReorderBuffer<Size>::idle() const {
+  return this->is_empty() || Completed.empty();
+}
+
+template <uint32_t Size>
+int ReorderBuffer<Size>::allocate(pipeline_trace_t* trace) {
   assert(!this->is_full());
   if (this->is_full())
     return -1;  
@@ -75,7 +85,8 @@ int ReorderBuffer::allocate(pipeline_trace_t* trace) {
   return index;
 }
 
-int ReorderBuffer::pop() {
+template <uint32_t Size>
+int ReorderBuffer<Size>::pop() {
   assert(!this->is_empty());
   assert(store_[head_index_].trace != nullptr);
   assert(store_[head_index_].completed);
@@ -88,15 +99,18 @@ int ReorderBuffer::pop() {
   return head_index_;
 }
 
-bool ReorderBuffer::is_full() const  {
+template <uint32_t Size>
+bool ReorderBuffer<Size>::is_full() const  {
   return count_ == store_.size();
 }
 
-bool ReorderBuffer::is_empty() const {
+template <uint32_t Size>
+bool ReorderBuffer<Size>::is_empty() const {
   return count_ == 0;
 }
 
-void ReorderBuffer::dump() {
+template <uint32_t Size>
+void ReorderBuffer<Size>::dump() {
   for (int i = 0; i < (int)store_.size(); ++i) {
     auto& entry = store_[i];
     if (entry.trace != nullptr) {
@@ -104,3 +118,7 @@ void ReorderBuffer::dump() {
     }
   }
 }
+
+// the common sizes
+template class tinyrv::ReorderBuffer<ROB_SIZE>;
+template class tinyrv::ReorderBuffer<0>;
@@ -13,20 +13,21 @@
 
 #pragma once
 
-#include <vector>
 #include <simobject.h>
+#include <sizedarray.h>
+#include "RAT.h"
 
 namespace tinyrv {
 
-class Scoreboard;
-
-class ReorderBuffer : public SimObject<ReorderBuffer> {
+// Size = 0 selects a buffer sized at construction
+template <uint32_t Size>
+class ReorderBuffer : public SimObject<ReorderBuffer<Size>> {
 public:
   
   SimPort<int> Completed;
   SimPort<pipeline_trace_t*> Committed;
 
-  ReorderBuffer(const SimContext& ctx, Scoreboard* scoreboard, uint32_t size);
+  ReorderBuffer(const SimContext& ctx, RegisterAliasTable* RAT, uint32_t size);
 
   ~ReorderBuffer();
 
@@ -34,6 +35,8 @@ public:
 
   void tick();
 
+  bool idle() const;
+
   int allocate(pipeline_trace_t* trace);
 
   int pop();
@@ -51,11 +54,15 @@ private:
     bool completed;
   };
   
-  Scoreboard* scoreboard_;
-  std::vector<rob_entry_t> store_;
+  RegisterAliasTable* RAT_;
+  SizedArray<rob_entry_t, Size> store_;
   int head_index_;
   int tail_index_;
   uint32_t count_;  
 };
 
+// the common sizes, instantiated in ROB.cpp
+extern template class ReorderBuffer<ROB_SIZE>;
+extern template class ReorderBuffer<0>;
+
 }
\ No newline at end of file
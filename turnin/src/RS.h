@@ -12,10 +12,19 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
-#include <vector>
+#pragma once
+
+#include <sizedarray.h>
+#include <bitmanip.h>
 
 namespace tinyrv {
 
+// Size = 0 selects a station sized at construction.
+// Wakeup and select work on bitmasks with one bit per entry: each producer
+// entry has a row of waiting consumers per operand, so a result clears its
+// dependents with a few word-wide operations, and select is a
+// find-first-set over the ready entries.
+template <uint32_t Size>
 class ReservationStation {
 public:
 
@@ -31,28 +40,131 @@ public:
   ReservationStation(uint32_t size) 
     : store_(size)
     , indices_(size)
-    , next_index_(0) {
-    for (uint32_t i = 0; i < size; ++i) {
+    , words_((size + 63) / 64)
+    , ready_(words_)
+    , blocked1_(words_)
+    , blocked2_(words_)
+    , waiters1_(size * words_)
+    , waiters2_(size * words_) {
+    this->clear();
+  }
+
+  ~ReservationStation() {}
+
+  void clear() {
+    for (uint32_t i = 0; i < store_.size(); ++i) {
       store_[i].valid = false;
       indices_[i] = i;
     }
+    next_index_ = 0;
+    ready_.fill(0);
+    blocked1_.fill(0);
+    blocked2_.fill(0);
+    waiters1_.fill(0);
+    waiters2_.fill(0);
   }
 
-  ~ReservationStation() {}
-
   int push(pipeline_trace_t* trace, int rob_index, int rs1_index, int rs2_index) {
     assert(!this->is_full());
     int index = indices_[next_index_++];
     store_[index] = {true, false, rob_index, rs1_index, rs2_index, trace};
+    uint32_t w = index / 64;
+    uint64_t bit = 1ull << (index % 64);
+    if (rs1_index != -1) {
+      waiters1_[rs1_index * this->words() + w] |= bit;
+      blocked1_[w] |= bit;
+    }
+    if (rs2_index != -1) {
+      waiters2_[rs2_index * this->words() + w] |= bit;
+      blocked2_[w] |= bit;
+    }
+    if (rs1_index == -1 && rs2_index == -1) {
+      ready_[w] |= bit;
+    }
     return index;
   }
 
   void remove(uint32_t index) {
     assert(index < store_.size() && !this->is_empty());
-    store_[index].valid = false;
+    auto& entry = store_[index];
+    uint32_t w = index / 64;
+    uint64_t bit = 1ull << (index % 64);
+    if (entry.rs1_index != -1) {
+      waiters1_[entry.rs1_index * this->words() + w] &= ~bit;
+    }
+    if (entry.rs2_index != -1) {
+      waiters2_[entry.rs2_index * this->words() + w] &= ~bit;
+    }
+    blocked1_[w] &= ~bit;
+    blocked2_[w] &= ~bit;
+    ready_[w] &= ~bit;
+    entry.valid = false;
     indices_[--next_index_] = index;    
   }
 
+  // the result of the given producer entry is available, 
+  // release its dependents and mark those now ready
+  void wakeup(int rs_index) {
+    if (rs_index < 0)
+      return;
+    auto row1 = &waiters1_[rs_index * this->words()];
+    auto row2 = &waiters2_[rs_index * this->words()];
+    for (uint32_t w = 0; w < this->words(); ++w) {
+      uint64_t woken = row1[w] | row2[w];
+      if (woken == 0)
+        continue;
+      blocked1_[w] &= ~row1[w];
+      blocked2_[w] &= ~row2[w];
+      ready_[w] |= woken & ~(blocked1_[w] | blocked2_[w]);
+      // keep the entries' operand indices in sync
+      do {
+        uint32_t i = count_trailing_zeros(woken);
+        uint64_t bit = 1ull << i;
+        auto& entry = store_[w * 64 + i];
+        if (row1[w] & bit) {
+          entry.rs1_index = -1;
+        }
+        if (row2[w] & bit) {
+          entry.rs2_index = -1;
+        }
+        woken &= woken - 1;
+      } while (woken != 0);
+      row1[w] = 0;
+      row2[w] = 0;
+    }
+  }
+
+  // first entry at or after index with both operands available 
+  // and not yet running, -1 if none
+  int find_ready(uint32_t index) const {
+    if (index >= store_.size())
+      return -1;
+    uint32_t w = index / 64;
+    uint64_t bits = ready_[w] & (~0ull << (index % 64));
+    for (;;) {
+      if (bits != 0)
+        return w * 64 + count_trailing_zeros(bits);
+      if (++w == this->words())
+        return -1;
+      bits = ready_[w];
+    }
+  }
+
+  bool has_ready() const {
+    for (uint32_t w = 0; w < this->words(); ++w) {
+      if (ready_[w] != 0)
+        return true;
+    }
+    return false;
+  }
+
+  // the entry has been assigned an FU
+  void set_running(uint32_t index) {
+    assert(store_[index].valid && !store_[index].running);
+    store_[index].running = true;
+    ready_[index / 64] &= ~(1ull << (index % 64));
+  }
+
   entry_t& operator[](uint32_t index) {
     return store_[index];
   }
@@ -84,9 +196,24 @@ public:
 
 private:
 
-  std::vector<entry_t> store_;
-  std::vector<uint32_t> indices_;
+  static constexpr uint32_t Words = (Size + 63) / 64;
+
+  uint32_t words() const {
+    return Size ? Words : words_;
+  }
+
+  SizedArray<entry_t, Size> store_;
+  SizedArray<uint32_t, Size> indices_;
   uint32_t next_index_;
+
+  // bitmasks over the entries, waitersN_ holds one row per producer
+  // entry of the consumers waiting on it for operand N
+  uint32_t words_;
+  SizedArray<uint64_t, Words> ready_;
+  SizedArray<uint64_t, Words> blocked1_;
+  SizedArray<uint64_t, Words> blocked2_;
+  SizedArray<uint64_t, Size * Words> waiters1_;
+  SizedArray<uint64_t, Size * Words> waiters2_;
 };
 
-}
\ No newline at end of file
+}
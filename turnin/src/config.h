@@ -27,12 +27,59 @@
 
 #define ROB_SIZE 16
 
+#define LATCH_SIZE 2
+
 #define NUM_REGS 32
 
 #ifndef DEBUG_LEVEL
 #define DEBUG_LEVEL 3
 #endif
 
+#ifndef DECODE_CACHE_SIZE
+#define DECODE_CACHE_SIZE 4096
+#endif
+
+// use direct-threaded dispatch in the emulator
+// (debug builds default to the traced table dispatch)
+#ifndef EMU_THREADED
+#ifdef NDEBUG
+#define EMU_THREADED 1
+#else
+#define EMU_THREADED 0
+#endif
+#endif
+
+// support running the emulator ahead of the timing model on its own
+// thread, enabled per run with -A (debug builds keep a single thread
+// for ordered traces)
+#ifndef EMU_ASYNC
+#ifdef NDEBUG
+#define EMU_ASYNC 1
+#else
+#define EMU_ASYNC 0
+#endif
+#endif
+
+#ifndef EMU_QUEUE_SIZE
+#define EMU_QUEUE_SIZE 1024
+#endif
+
+// traces in flight: emulator queue plus pipeline window
+#ifndef TRACE_POOL_SIZE
+#define TRACE_POOL_SIZE (EMU_QUEUE_SIZE + ROB_SIZE + NUM_RSS + 16)
+#endif
+
+// event log records staged in memory between file writes
+#ifndef EVENT_LOG_SIZE
+#define EVENT_LOG_SIZE 65536
+#endif
+
+// default cycle limit of a timing run, so a model that never
+// completes is abandoned instead of hanging (0: no limit)
+#ifndef MAX_CYCLES
+#define MAX_CYCLES 100000000
+#endif
+
 #ifndef RAM_PAGE_SIZE
 #define RAM_PAGE_SIZE 4096
 #endif
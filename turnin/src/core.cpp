@@ -16,131 +16,203 @@
 #include <string.h>
 #include <assert.h>
 #include <util.h>
+#include <backoff.h>
 #include "types.h"
 #include "core.h"
 #include "debug.h"
 #include "processor_impl.h"
-#include "inorder.h"
-#include "scoreboard.h"
 #include "FU.h"
+#include "tracefile.h"
+#include "tracechannel.h"
 
 using namespace tinyrv;
 
-extern bool gshare_enabled;
-extern bool ooo_enabled;
-
-Core::Core(const SimContext& ctx, uint32_t core_id, ProcessorImpl* processor)
-    : SimObject(ctx, "core")
+Core::Core(const SimContext& ctx, const char* name, uint32_t core_id, ProcessorImpl* processor, const ProcessorConfig& config)
+    : SimObjectBase(ctx, name)
     , core_id_(core_id)
     , processor_(processor)
     , emulator_(this)
+    , trace_writer_(nullptr)
+    , trace_source_(nullptr)
+    , trace_pool_(TRACE_POOL_SIZE)
+    , trace_queue_(EMU_QUEUE_SIZE)
+    , emu_parked_(false)
+    , emu_stop_(false)
+    , emu_async_(false)
 {
-  // create CPU pipeline
-  if (ooo_enabled) {
-    pipeline_ = new Scoreboard(this, NUM_RSS, ROB_SIZE);
-  } else {
-    pipeline_ = new InorderPipeline(this);
-  }
-
   // create functional units
-  FUs_[(int)FUType::ALU] = FunctionalUnit::Create(ALU_LATENCY);
-  FUs_[(int)FUType::LSU] = FunctionalUnit::Create(LSU_LATENCY);
-  FUs_[(int)FUType::CSR] = FunctionalUnit::Create(CSR_LATENCY);
+  FUs_[(int)FUType::ALU] = FunctionalUnit::Create(this->platform(), config.alu_latency);
+  FUs_[(int)FUType::LSU] = FunctionalUnit::Create(this->platform(), config.lsu_latency);
+  FUs_[(int)FUType::CSR] = FunctionalUnit::Create(this->platform(), config.csr_latency);
 
   this->reset();
 }
 
 Core::~Core() {
-  delete pipeline_;
+  this->stop_async();
 }
 
 void Core::reset() { 
   emulator_.clear();
+  // the traces in flight were dropped with the pipeline state
+  trace_pool_.reset();
   stalled_trace_ = nullptr;
   branch_stalls_ = 0;
   fetched_instrs_ = 0;
+  fetch_allocs_ = 0;
+  fetch_enabled_ = true;
   perf_stats_ = PerfStats();
+  stats_base_ = PerfStats();
 }
 
-void Core::tick() {
-  this->commit();
-  this->writeback();
-  this->execute();
-  this->issue();
-
-  pipeline_->dump();
-  ++perf_stats_.cycles;
-  DPN(2, std::flush);  
+void Core::skip(uint64_t cycles) {
+  perf_stats_.cycles += cycles;
 }
 
-void Core::issue() {
-  auto trace = stalled_trace_;
-  if (branch_stalls_ != 0) {
-    --branch_stalls_;
-    DT(3, "*** branch stalled!: " << *trace);
-    return;
+pipeline_trace_t* Core::fetch() {
+  if (trace_source_) {
+    // replay mode, the trace stream replaces the emulator
+    return trace_source_->next(trace_pool_);
   }
 
-  if (trace == nullptr) {
-    trace = emulator_.step();
-    stalled_trace_ = trace;
-    ++fetched_instrs_;
-    if (trace->fu_type == FUType::ALU 
-     && trace->alu_op == AluOp::BRANCH) {
-      if (gshare_enabled) {
-        if (!gshare_.predict(trace)) {
-          DT(3, "*** branch stalled!: " << *trace);
-          branch_stalls_ = 2;
-          return;
+  pipeline_trace_t* trace;
+  if (emu_async_) {
+    // consume from the emulator thread, a parked emulator is waiting
+    // for its sync point to execute here, in order with the timing
+    Backoff backoff;
+    while (!trace_queue_.try_pop(&trace)) {
+      if (emu_parked_.load(std::memory_order_acquire)) {
+        if (!trace_queue_.try_pop(&trace)) {
+          trace = emulator_.step();
+          emu_parked_.store(false, std::memory_order_release);
         }
-      } else {        
-        DT(3, "*** branch stalled!: " << *trace);
-        branch_stalls_ = 2;
+        break;
+      }
+      backoff.wait();
+    }
+  } else {
+    trace = emulator_.step();
+  }
+
+  if (trace_writer_) {
+    trace_writer_->write(*trace);
+  }
+  return trace;
+}
+
+void Core::emulate() {
+  Word exitcode;
+  Backoff parked;
+  while (!emu_stop_.load(std::memory_order_relaxed)) {
+    if (emu_parked_.load(std::memory_order_acquire)) {
+      parked.wait();
+      continue;
+    }
+    parked.reset();
+    if (emulator_.check_exit(&exitcode, false))
+      break;
+    if (emulator_.sync_point()) {
+      emu_parked_.store(true, std::memory_order_release);
+      continue;
+    }
+    auto trace = emulator_.step();
+    Backoff backoff;
+    while (!trace_queue_.try_push(trace)) {
+      if (emu_stop_.load(std::memory_order_relaxed)) {
+        trace_pool_.release(trace);
         return;
       }
+      backoff.wait();
     }
   }
+}
 
-  if (!pipeline_->issue(trace)) {
-    DT(3, "*** issue stalled!: " << *trace);
+void Core::broadcast(const std::vector<TraceChannel*>& channels) {
+  // functional run feeding each timing model a copy of every trace
+  Word exitcode;
+  if (emulator_.check_exit(&exitcode, false)) {
+    for (auto channel : channels) {
+      channel->close(exitcode);
+    }
     return;
   }
+  for (;;) {
+    auto trace = emulator_.step();
+    if (emulator_.check_exit(&exitcode, false)) {
+      for (auto channel : channels) {
+        channel->push_last(*trace, exitcode);
+      }
+      trace_pool_.release(trace);
+      break;
+    }
+    uint32_t listeners = 0;
+    for (auto channel : channels) {
+      if (channel->detached())
+        continue;
+      channel->push(*trace);
+      ++listeners;
+    }
+    trace_pool_.release(trace);
+    if (listeners == 0) {
+      // every timing model was abandoned
+      break;
+    }
+  }
+}
 
-  DT(3, "pipeline-issue: " << *trace);
-
-  stalled_trace_ = nullptr;  
+void Core::snapshot(Emulator::snapshot_t* snapshot) const {
+  assert(!emu_async_);
+  emulator_.snapshot(snapshot);
 }
 
-void Core::execute() {   
-  auto traces = pipeline_->execute();
-  for (auto trace : traces) {
-    __unused (trace);
-    DT(3, "pipeline-execute: " << *trace);
-  }
+void Core::restore(const Emulator::snapshot_t& snapshot) {
+  // only valid while the pipeline is empty
+  assert(!emu_async_);
+  emulator_.restore(snapshot);
 }
 
-void Core::writeback() {
-  auto trace = pipeline_->writeback();
-  if (trace) {
-    __unused (trace);
-    DT(3, "pipeline-writeback: " << *trace);
-  }
+void Core::start_async() {
+  // the functional stream does not depend on timing except at
+  // sync points, so the emulator can run ahead on another host core
+  if (emu_async_ || trace_source_)
+    return;
+  emu_stop_ = false;
+  emu_parked_ = false;
+  emu_async_ = true;
+  emu_thread_ = std::thread(&Core::emulate, this);
 }
 
-void Core::commit() {
-  auto trace = pipeline_->commit();
-  if (trace) {  
-    DT(3, "pipeline-commit: " << *trace);
-    assert(perf_stats_.instrs <= fetched_instrs_);
-    ++perf_stats_.instrs;
-    delete trace;
+void Core::stop_async() {
+  if (!emu_async_)
+    return;
+  emu_stop_ = true;
+  emu_thread_.join();
+  pipeline_trace_t* trace;
+  while (trace_queue_.try_pop(&trace)) {
+    trace_pool_.release(trace);
   }
+  emu_async_ = false;
 }
 
 bool Core::check_exit(Word* exitcode, bool riscv_test) const {
+  if (trace_source_)
+    return trace_source_->check_exit(exitcode, riscv_test);
   return emulator_.check_exit(exitcode, riscv_test);
 }
 
+uint64_t Core::fast_forward(uint64_t instrs) {
+  // only valid while the pipeline is empty
+  assert(!this->running() || fetched_instrs_ == 0);
+  assert(!emu_async_);
+  return emulator_.fast_forward(instrs);
+}
+
+void Core::reset_stats() {
+  // start a new measurement region, the running totals
+  // are kept for the cycle and instret CSRs
+  stats_base_ = perf_stats_;
+}
+
 bool Core::running() const {
   return (perf_stats_.instrs != fetched_instrs_) || (fetched_instrs_ == 0);
 }
@@ -149,6 +221,22 @@ void Core::attach_ram(RAM* ram) {
   emulator_.attach_ram(ram);
 }
 
+void Core::attach_trace_writer(TraceWriter* writer) {
+  trace_writer_ = writer;
+}
+
+void Core::attach_trace_source(TraceSource* source) {
+  trace_source_ = source;
+}
+
+Core::PerfStats Core::region_stats() const {
+  PerfStats stats;
+  stats.instrs = perf_stats_.instrs - stats_base_.instrs;
+  stats.cycles = perf_stats_.cycles - stats_base_.cycles;
+  return stats;
+}
+
 void Core::showStats() {
-  std::cout << std::dec << "PERF: instrs=" << perf_stats_.instrs << ", cycles=" << perf_stats_.cycles << std::endl;
+  auto stats = this->region_stats();
+  std::cout << std::dec << "PERF: instrs=" << stats.instrs << ", cycles=" << stats.cycles << std::endl;
 }
\ No newline at end of file
@@ -15,28 +15,39 @@
 
 #include <string>
 #include <vector>
+#include <array>
 #include <list>
 #include <stack>
 #include <queue>
 #include <unordered_map>
 #include <memory>
 #include <set>
+#include <thread>
+#include <atomic>
 #include <simobject.h>
+#include <spsc_queue.h>
 #include "debug.h"
 #include "types.h"
 #include "emulator.h"
+#include "trace.h"
 #include "FU.h"
-#include "gshare.h"
+#include "processor.h"
 
 namespace tinyrv {
 
 class ProcessorImpl;
 class Instr;
 class RAM;
-class Pipeline;
+class TraceWriter;
+class TraceSource;
+class TraceChannel;
 
-class Core : public SimObject<Core> {
+// State and functional front-end shared by the core variants, the timing
+// model is provided by CoreVariant<Pipeline, Predictor> in core_variant.h.
+class Core : public SimObjectBase {
 public:
+  typedef std::shared_ptr<Core> Ptr;
+
   struct PerfStats {
     uint64_t cycles;
     uint64_t instrs;
@@ -47,45 +58,92 @@ public:
     {}
   };
 
-  Core(const SimContext& ctx, uint32_t core_id, ProcessorImpl* processor);
-  ~Core();
+  virtual ~Core();
 
-  void reset();
+  virtual void reset();
 
-  void tick();
+  void skip(uint64_t cycles);
 
   void attach_ram(RAM* ram);
 
+  void attach_trace_writer(TraceWriter* writer);
+
+  void attach_trace_source(TraceSource* source);
+
   bool running() const;
 
   bool check_exit(Word* exitcode, bool riscv_test) const;
 
+  uint64_t fast_forward(uint64_t instrs);
+
+  void broadcast(const std::vector<TraceChannel*>& channels);
+
+  void snapshot(Emulator::snapshot_t* snapshot) const;
+
+  void restore(const Emulator::snapshot_t& snapshot);
+
+  void start_async();
+
+  void stop_async();
+
+  void reset_stats();
+
+  void set_fetch_enabled(bool enable) {
+    fetch_enabled_ = enable;
+  }
+
+  const PerfStats& perf_stats() const {
+    return perf_stats_;
+  }
+
+  // statistics of the current measurement region
+  PerfStats region_stats() const;
+
+  // heap allocations made by the functional front-end (debug builds)
+  uint64_t fetch_allocs() const {
+    return fetch_allocs_;
+  }
+
   void showStats();
 
-private:
+protected:
+
+  Core(const SimContext& ctx, const char* name, uint32_t core_id, ProcessorImpl* processor, const ProcessorConfig& config);
 
-  void issue();
-  void execute();
-  void writeback();
-  void commit();
+  pipeline_trace_t* fetch();
+
+  void emulate();
 
   uint32_t core_id_;
   ProcessorImpl* processor_;
   Emulator emulator_;
 
   std::array<FunctionalUnit::Ptr, NUM_FUS> FUs_;
-  Pipeline* pipeline_;
-  GShare gshare_;
+
+  TraceWriter* trace_writer_;
+  TraceSource* trace_source_;
+
+  TracePool trace_pool_;
+
+  // emulator thread state
+  SPSCQueue<pipeline_trace_t*> trace_queue_;
+  std::thread emu_thread_;
+  std::atomic<bool> emu_parked_;
+  std::atomic<bool> emu_stop_;
+  bool emu_async_;
 
   int branch_stalls_;
   pipeline_trace_t* stalled_trace_;
   uint64_t fetched_instrs_;
+  uint64_t fetch_allocs_;
+  bool fetch_enabled_;
 
   PerfStats perf_stats_;
+  PerfStats stats_base_;
 
   friend class Emulator;
   friend class InorderPipeline;
-  friend class Scoreboard;  
+  template <uint32_t, uint32_t> friend class Scoreboard;
 };
 
 } // namespace tinyrv
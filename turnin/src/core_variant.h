@@ -0,0 +1,158 @@
+// Copyright 2024 Blaise Tine
+//
+// Licensed under the Apache License;
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include "core.h"
+#include "pipeline.h"
+#include "gshare.h"
+#include "eventlog.h"
+
+namespace tinyrv {
+
+// without a predictor, every branch stalls the fetch until it resolves
+class NoPredictor {
+public:
+  bool predict(pipeline_trace_t* /*trace*/) {
+    return false;
+  }
+};
+
+// Core timing model specialized on its pipeline and branch predictor.
+// The variants are instantiated next to their pipeline implementation
+// (inorder.cpp, scoreboard.cpp) so the stages inline into tick().
+template <typename Pipeline, typename Predictor>
+class CoreVariant final : public SimObject<CoreVariant<Pipeline, Predictor>, Core> {
+public:
+  CoreVariant(const SimContext& ctx, uint32_t core_id, ProcessorImpl* processor, const ProcessorConfig& config)
+    : SimObject<CoreVariant, Core>(ctx, "core", core_id, processor, config)
+    , pipeline_(this, config)
+    , executed_(pipeline_.execute_width())
+  {}
+
+  void reset() override {
+    Core::reset();
+    pipeline_.reset();
+  }
+
+  void tick() {
+    this->commit();
+    this->writeback();
+    this->execute();
+    this->issue();
+
+    pipeline_.dump();
+    ++this->perf_stats_.cycles;
+    DPN(2, std::flush);
+  }
+
+  bool idle() const {
+    // the core is quiescent when its stalled trace is blocked
+    // on a hazard that only a pending event can release
+    return (this->stalled_trace_ != nullptr)
+        && (this->branch_stalls_ == 0)
+        && pipeline_.idle(this->stalled_trace_);
+  }
+
+  void skip(uint64_t cycles) {
+    Core::skip(cycles);
+    // the stalled trace retried its issue in every skipped cycle
+    if (EventLog::instance().mask() & (1u << uint32_t(EventCode::ISSUE_STALL))) {
+      EventLog::instance().record(EventCode::ISSUE_STALL, *this->stalled_trace_, this->platform().cycles(), cycles);
+    }
+  }
+
+private:
+
+  void issue() {
+    auto trace = this->stalled_trace_;
+    if (this->branch_stalls_ != 0) {
+      --this->branch_stalls_;
+      DT(3, "*** branch stalled!: " << *trace);
+      EL(BRANCH_STALL, *trace);
+      return;
+    }
+
+    if (trace == nullptr) {
+      if (!this->fetch_enabled_)
+        return;
+    #ifndef NDEBUG
+      // the front-end allocates on first decode and first page touch
+      auto allocs = heap_allocs();
+      trace = this->fetch();
+      this->fetch_allocs_ += heap_allocs() - allocs;
+    #else
+      trace = this->fetch();
+    #endif
+      if (trace == nullptr)
+        return;
+      this->stalled_trace_ = trace;
+      ++this->fetched_instrs_;
+      if (trace->fu_type == FUType::ALU
+       && trace->alu_op == AluOp::BRANCH
+       && !predictor_.predict(trace)) {
+        DT(3, "*** branch stalled!: " << *trace);
+        EL(BRANCH_STALL, *trace);
+        this->branch_stalls_ = 2;
+        return;
+      }
+    }
+
+    if (!pipeline_.issue(trace)) {
+      DT(3, "*** issue stalled!: " << *trace);
+      EL(ISSUE_STALL, *trace);
+      return;
+    }
+
+    DT(3, "pipeline-issue: " << *trace);
+    EL(ISSUE, *trace);
+
+    this->stalled_trace_ = nullptr;
+  }
+
+  void execute() {
+    executed_.clear();
+    pipeline_.execute(&executed_);
+    for (auto trace : executed_) {
+      __unused (trace);
+      DT(3, "pipeline-execute: " << *trace);
+      EL(EXECUTE, *trace);
+    }
+  }
+
+  void writeback() {
+    auto trace = pipeline_.writeback();
+    if (trace) {
+      __unused (trace);
+      DT(3, "pipeline-writeback: " << *trace);
+      EL(WRITEBACK, *trace);
+    }
+  }
+
+  void commit() {
+    auto trace = pipeline_.commit();
+    if (trace) {
+      DT(3, "pipeline-commit: " << *trace);
+      EL(COMMIT, *trace);
+      assert(this->perf_stats_.instrs <= this->fetched_instrs_);
+      ++this->perf_stats_.instrs;
+      this->trace_pool_.release(trace);
+    }
+  }
+
+  Pipeline    pipeline_;
+  Predictor   predictor_;
+  TraceBuffer executed_;
+};
+
+}
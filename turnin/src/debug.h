@@ -48,13 +48,13 @@
 
 #define DT(lvl, x) do { \
   if ((lvl) <= DEBUG_LEVEL) { \
-    std::cout TRACE_HEADER << std::setw(10) << std::dec << SimPlatform::instance().cycles() << std::setw(0) << ": " << x << std::endl; \
+    std::cout TRACE_HEADER << std::setw(10) << std::dec << SimPlatform::current()->cycles() << std::setw(0) << ": " << x << std::endl; \
   } \
 } while(0)
 
 #define DTH(lvl, x) do { \
   if ((lvl) <= DEBUG_LEVEL) { \
-    std::cout TRACE_HEADER << std::setw(10) << std::dec << SimPlatform::instance().cycles() << std::setw(0) << ": " << x; \
+    std::cout TRACE_HEADER << std::setw(10) << std::dec << SimPlatform::current()->cycles() << std::setw(0) << ": " << x; \
   } \
 } while(0)
 
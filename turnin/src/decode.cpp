@@ -17,7 +17,6 @@
 #include <string.h>
 #include <iomanip>
 #include <vector>
-#include <unordered_map>
 #include <util.h>
 #include "debug.h"
 #include "types.h"
@@ -28,20 +27,6 @@ using namespace tinyrv;
 
 namespace tinyrv {
 
-static const std::unordered_map<Opcode, InstType> sc_instTable = {
-  {Opcode::R,     InstType::R},
-  {Opcode::L,     InstType::I},
-  {Opcode::I,     InstType::I},
-  {Opcode::S,     InstType::S},
-  {Opcode::B,     InstType::B},
-  {Opcode::LUI,   InstType::U},
-  {Opcode::AUIPC, InstType::U},
-  {Opcode::JAL,   InstType::J},
-  {Opcode::JALR,  InstType::I},
-  {Opcode::SYS,   InstType::I},
-  {Opcode::FENCE, InstType::I},
-};
-
 enum Constants {
   width_opcode= 7,
   width_reg   = 5,
@@ -66,115 +51,192 @@ enum Constants {
   mask_j_imm  = (1 << width_j_imm) - 1,
 };
 
+///////////////////////////////////////////////////////////////////////////////
+// Per-format field extractors, selected by the spec table entries.
+
+template <InstType F>
+static void decode_fields(uint32_t code, Instr* instr);
+
+template <>
+void decode_fields<InstType::R>(uint32_t code, Instr* instr) {
+  instr->setDestReg((code >> shift_rd) & mask_reg, RegType::Integer);
+  instr->addSrcReg((code >> shift_rs1) & mask_reg, RegType::Integer);
+  instr->addSrcReg((code >> shift_rs2) & mask_reg, RegType::Integer);
+  instr->setFunc3((code >> shift_func3) & mask_func3);
+  instr->setFunc7((code >> shift_func7) & mask_func7);
+}
+
+template <>
+void decode_fields<InstType::I>(uint32_t code, Instr* instr) {
+  instr->setDestReg((code >> shift_rd) & mask_reg, RegType::Integer);
+  instr->addSrcReg((code >> shift_rs1) & mask_reg, RegType::Integer);
+  instr->setFunc3((code >> shift_func3) & mask_func3);
+  instr->setImm(sext(code >> shift_rs2, width_i_imm));
+}
+
+template <>
+void decode_fields<InstType::I_SHAMT>(uint32_t code, Instr* instr) {
+  instr->setDestReg((code >> shift_rd) & mask_reg, RegType::Integer);
+  instr->addSrcReg((code >> shift_rs1) & mask_reg, RegType::Integer);
+  instr->setFunc3((code >> shift_func3) & mask_func3);
+  instr->setImm((code >> shift_rs2) & mask_reg);
+  instr->setFunc7((code >> shift_func7) & mask_func7);
+}
+
+template <>
+void decode_fields<InstType::I_CSR>(uint32_t code, Instr* instr) {
+  instr->setDestReg((code >> shift_rd) & mask_reg, RegType::Integer);
+  instr->setFunc3((code >> shift_func3) & mask_func3);
+  instr->addSrcReg((code >> shift_rs1) & mask_reg, RegType::Integer);
+  instr->setImm(code >> shift_rs2);
+}
+
+template <>
+void decode_fields<InstType::I_CSRI>(uint32_t code, Instr* instr) {
+  instr->setDestReg((code >> shift_rd) & mask_reg, RegType::Integer);
+  instr->setFunc3((code >> shift_func3) & mask_func3);
+  // zimm
+  instr->addSrcReg((code >> shift_rs1) & mask_reg, RegType::None);
+  instr->setImm(code >> shift_rs2);
+}
+
+template <>
+void decode_fields<InstType::I_SYS>(uint32_t code, Instr* instr) {
+  instr->setFunc3((code >> shift_func3) & mask_func3);
+  instr->setImm(code >> shift_rs2);
+}
+
+template <>
+void decode_fields<InstType::S>(uint32_t code, Instr* instr) {
+  auto rd    = (code >> shift_rd) & mask_reg;
+  auto func7 = (code >> shift_func7) & mask_func7;
+  instr->addSrcReg((code >> shift_rs1) & mask_reg, RegType::Integer);
+  instr->addSrcReg((code >> shift_rs2) & mask_reg, RegType::Integer);
+  instr->setFunc3((code >> shift_func3) & mask_func3);
+  auto imm = (func7 << width_reg) | rd;
+  instr->setImm(sext(imm, width_i_imm));
+}
+
+template <>
+void decode_fields<InstType::B>(uint32_t code, Instr* instr) {
+  auto rd    = (code >> shift_rd) & mask_reg;
+  auto func7 = (code >> shift_func7) & mask_func7;
+  instr->addSrcReg((code >> shift_rs1) & mask_reg, RegType::Integer);
+  instr->addSrcReg((code >> shift_rs2) & mask_reg, RegType::Integer);
+  instr->setFunc3((code >> shift_func3) & mask_func3);
+  auto bit_11   = rd & 0x1;
+  auto bits_4_1 = rd >> 1;
+  auto bit_10_5 = func7 & 0x3f;
+  auto bit_12   = func7 >> 6;
+  auto imm = (bits_4_1 << 1) | (bit_10_5 << 5) | (bit_11 << 11) | (bit_12 << 12);
+  instr->setImm(sext(imm, width_i_imm+1));
+}
+
+template <>
+void decode_fields<InstType::U>(uint32_t code, Instr* instr) {
+  instr->setDestReg((code >> shift_rd) & mask_reg, RegType::Integer);
+  auto imm = (code >> shift_func3) << shift_func3;
+  instr->setImm(imm);
+}
+
+template <>
+void decode_fields<InstType::J>(uint32_t code, Instr* instr) {
+  instr->setDestReg((code >> shift_rd) & mask_reg, RegType::Integer);
+  auto unordered  = code >> shift_func3;
+  auto bits_19_12 = unordered & 0xff;
+  auto bit_11     = (unordered >> 8) & 0x1;
+  auto bits_10_1  = (unordered >> 9) & 0x3ff;
+  auto bit_20     = (unordered >> 19) & 0x1;
+  auto imm = (bits_10_1 << 1) | (bit_11 << 11) | (bits_19_12 << 12) | (bit_20 << 20);
+  instr->setImm(sext(imm, width_j_imm+1));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+struct instr_spec_t {
+  const char* name;
+  uint32_t    match;
+  uint32_t    mask;
+  void (*decode)(uint32_t code, Instr* instr);
+};
+
+#define INSTR_SPEC(name, format, match, mask, ...) {name, match, mask, &decode_fields<InstType::format>},
+
+static constexpr instr_spec_t sc_instSpecs[] = {
+  RV32_INSTR_TABLE(INSTR_SPEC)
+};
+
+#undef INSTR_SPEC
+
+static constexpr uint32_t sc_numInstSpecs = sizeof(sc_instSpecs) / sizeof(sc_instSpecs[0]);
+
+static_assert(sc_numInstSpecs < INSTR_ID_NONE, "instruction table too large");
+
+///////////////////////////////////////////////////////////////////////////////
+// 128-entry opcode table generated at compile time from the spec table,
+// giving each opcode's range of entries in sc_instSpecs.
+
+struct opcode_info_t {
+  uint8_t first;
+  uint8_t count;
+};
+
+struct opcode_table_t {
+  opcode_info_t entries[128];
+};
+
+static constexpr uint32_t spec_opcode(uint32_t i) {
+  return sc_instSpecs[i].match & 0x7f;
+}
+
+static constexpr uint32_t spec_first(uint32_t op, uint32_t i = 0) {
+  return (i == sc_numInstSpecs || spec_opcode(i) == op) ? i : spec_first(op, i + 1);
+}
+
+static constexpr uint32_t spec_count(uint32_t op, uint32_t i = 0) {
+  return (i == sc_numInstSpecs) ? 0 : ((spec_opcode(i) == op) + spec_count(op, i + 1));
+}
+
+static constexpr opcode_info_t opcode_info(uint32_t op) {
+  return opcode_info_t{uint8_t(spec_first(op)), uint8_t(spec_count(op))};
+}
+
+// entries of the same opcode must be contiguous
+static constexpr bool spec_grouped(uint32_t i = 1) {
+  return (i >= sc_numInstSpecs) ? true 
+    : (((spec_opcode(i) == spec_opcode(i-1)) || (spec_first(spec_opcode(i)) == i))
+       && spec_grouped(i + 1));
+}
+
+static_assert(spec_grouped(), "instruction table entries must be grouped by opcode");
+
+template <uint32_t... Is> struct index_seq {};
+template <uint32_t N, uint32_t... Is> struct make_index_seq : make_index_seq<N-1, N-1, Is...> {};
+template <uint32_t... Is> struct make_index_seq<0, Is...> { typedef index_seq<Is...> type; };
+
+template <uint32_t... Is>
+static constexpr opcode_table_t make_opcode_table(index_seq<Is...>) {
+  return opcode_table_t{{opcode_info(Is)...}};
+}
+
+static constexpr opcode_table_t sc_opcodeTable = make_opcode_table(make_index_seq<128>::type());
+
+static uint32_t lookup_spec(uint32_t code, const opcode_info_t& info) {
+  for (uint32_t i = info.first, n = info.first + info.count; i < n; ++i) {
+    if ((code & sc_instSpecs[i].mask) == sc_instSpecs[i].match)
+      return i;
+  }
+  return INSTR_ID_NONE;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
 static const char* op_string(const Instr &instr) {
-  auto opcode = instr.getOpcode();
-  auto func3  = instr.getFunc3();
-  auto func7  = instr.getFunc7();
-  auto imm    = instr.getImm();
-
-  switch (opcode) {
-  case Opcode::LUI:   return "LUI";
-  case Opcode::AUIPC: return "AUIPC";
-  case Opcode::R:
-    if (func7 & 0x1) {
-      switch (func3) {
-      case 0: return "MUL";
-      case 1: return "MULH";
-      case 2: return "MULHSU";
-      case 3: return "MULHU";
-      case 4: return "DIV";
-      case 5: return "DIVU";
-      case 6: return "REM";
-      case 7: return "REMU";
-      default:
-        std::abort();
-      }
-    } else {
-      switch (func3) {
-      case 0: return func7 ? "SUB" : "ADD";
-      case 1: return "SLL";
-      case 2: return "SLT";
-      case 3: return "SLTU";
-      case 4: return "XOR";
-      case 5: return (func7 & 0x20) ? "SRA" : "SRL";
-      case 6: return "OR";
-      case 7: return "AND";
-      default:
-        std::abort();
-      }
-    }
-  case Opcode::I:
-    switch (func3) {
-    case 0: return "ADDI";
-    case 1: return "SLLI";
-    case 2: return "SLTI";
-    case 3: return "SLTIU";
-    case 4: return "XORI";
-    case 5: return (func7 & 0x20) ? "SRAI" : "SRLI";
-    case 6: return "ORI";
-    case 7: return "ANDI";
-    default:
-      std::abort();
-    }  
-  case Opcode::B:
-    switch (func3) {
-    case 0: return "BEQ";
-    case 1: return "BNE";
-    case 4: return "BLT";
-    case 5: return "BGE";
-    case 6: return "BLTU";
-    case 7: return "BGEU";
-    default:
-      std::abort();
-    }
-  case Opcode::JAL:   return "JAL";
-  case Opcode::JALR:  return "JALR";
-  case Opcode::L:
-    switch (func3) {
-    case 0: return "LB";
-    case 1: return "LH";
-    case 2: return "LW";
-    case 3: return "LD";
-    case 4: return "LBU";
-    case 5: return "LHU";
-    case 6: return "LWU";
-    default:
-      std::abort();
-    }
-  case Opcode::S:
-    switch (func3) {
-    case 0: return "SB";
-    case 1: return "SH";
-    case 2: return "SW";
-    case 3: return "SD";
-    default:
-      std::abort();
-    }
-  case Opcode::SYS: 
-    switch (func3) {
-    case 0:
-      switch (imm) {
-      case 0x000: return "ECALL";
-      case 0x001: return "EBREAK";
-      case 0x002: return "URET";
-      case 0x102: return "SRET";
-      case 0x302: return "MRET";
-      default:
-        std::abort();      
-      }
-    case 1: return "CSRRW";
-    case 2: return "CSRRS";
-    case 3: return "CSRRC";
-    case 5: return "CSRRWI";
-    case 6: return "CSRRSI";
-    case 7: return "CSRRCI";
-    default:
-      std::abort();
-    }
-  case Opcode::FENCE: return "FENCE";
-  default:
+  auto id = instr.getId();
+  if (id >= sc_numInstSpecs) {
     std::abort();
   }
+  return sc_instSpecs[id].name;
 }
 
 std::ostream &operator<<(std::ostream &os, const Instr &instr) {
@@ -203,127 +265,22 @@ std::ostream &operator<<(std::ostream &os, const Instr &instr) {
 
 }
 
-std::shared_ptr<Instr> Emulator::decode(uint32_t code) const {  
-  auto instr = std::make_shared<Instr>();
+bool Emulator::decode(uint32_t code, Instr* instr) const {  
+  *instr = Instr();
   auto op = Opcode((code >> shift_opcode) & mask_opcode);
-  instr->setOpcode(op);
-
-  auto func3 = (code >> shift_func3) & mask_func3;
-  auto func7 = (code >> shift_func7) & mask_func7;
-
-  auto rd  = (code >> shift_rd)  & mask_reg;
-  auto rs1 = (code >> shift_rs1) & mask_reg;
-  auto rs2 = (code >> shift_rs2) & mask_reg;
-
-  auto op_it = sc_instTable.find(op);
-  if (op_it == sc_instTable.end()) {
+  auto& op_info = sc_opcodeTable.entries[(uint32_t)op];
+  if (op_info.count == 0) {
     std::cout << std::hex << "Error: invalid opcode: 0x" << static_cast<int>(op) << std::endl;
-    return nullptr;
+    return false;
   }
+  auto id = lookup_spec(code, op_info);
+  if (id == INSTR_ID_NONE)
+    return false;
+  instr->setOpcode(op);
+  instr->setId(id);
 
-  auto iType = op_it->second;
-  switch (iType) {
-  case InstType::R:
-    switch (op) {
-    default:
-      instr->setDestReg(rd, RegType::Integer);
-      instr->addSrcReg(rs1, RegType::Integer);
-      instr->addSrcReg(rs2, RegType::Integer);
-      break;
-    }
-    instr->setFunc3(func3);
-    instr->setFunc7(func7);
-    break;
-
-  case InstType::I: {
-    switch (op) {
-    case Opcode::I:
-      instr->setDestReg(rd, RegType::Integer);      
-      instr->addSrcReg(rs1, RegType::Integer);
-      instr->setFunc3(func3);
-      if (func3 == 0x1 || func3 == 0x5) {
-        // Shift instructions
-        instr->setImm(rs2);
-        instr->setFunc7(func7);
-      } else {
-        auto imm = code >> shift_rs2;
-        instr->setImm(sext(imm, width_i_imm));
-      }
-      break;    
-    case Opcode::L:
-    case Opcode::JALR: {
-      instr->setDestReg(rd, RegType::Integer);
-      instr->addSrcReg(rs1, RegType::Integer);
-      instr->setFunc3(func3);
-      auto imm = code >> shift_rs2;
-      instr->setImm(sext(imm, width_i_imm));
-    } break;
-    case Opcode::FENCE:
-      instr->setFunc3(func3);
-      instr->setImm(code >> shift_rs2);
-      break;
-    case Opcode::SYS:
-      if (func3 != 0) {
-        // CSR instructions
-        instr->setDestReg(rd, RegType::Integer);
-        instr->setFunc3(func3);
-        if (func3 < 5) { 
-          instr->addSrcReg(rs1, RegType::Integer);
-        } else {          
-          // zimm       
-          instr->addSrcReg(rs1, RegType::None);
-        }
-        instr->setImm(code >> shift_rs2);
-      } else {
-        // ECALL/EBREACK instructions
-        instr->setImm(code >> shift_rs2);
-      }     
-      break;
-    default:
-      std::abort();      
-      break;
-    }
-  } break;
-  case InstType::S: {    
-    instr->addSrcReg(rs1, RegType::Integer);
-    instr->addSrcReg(rs2, RegType::Integer);
-    instr->setFunc3(func3);
-    auto imm = (func7 << width_reg) | rd;
-    instr->setImm(sext(imm, width_i_imm));
-  } break;
-
-  case InstType::B: {
-    instr->addSrcReg(rs1, RegType::Integer);
-    instr->addSrcReg(rs2, RegType::Integer);
-    instr->setFunc3(func3);
-    auto bit_11   = rd & 0x1;
-    auto bits_4_1 = rd >> 1;
-    auto bit_10_5 = func7 & 0x3f;
-    auto bit_12   = func7 >> 6;
-    auto imm = (bits_4_1 << 1) | (bit_10_5 << 5) | (bit_11 << 11) | (bit_12 << 12);
-    instr->setImm(sext(imm, width_i_imm+1));
-  } break;
-
-  case InstType::U: {
-    instr->setDestReg(rd, RegType::Integer);
-    auto imm = (code >> shift_func3) << shift_func3;
-    instr->setImm(imm);
-  }  break;
-
-  case InstType::J: {
-    instr->setDestReg(rd, RegType::Integer);
-    auto unordered  = code >> shift_func3;
-    auto bits_19_12 = unordered & 0xff;
-    auto bit_11     = (unordered >> 8) & 0x1;
-    auto bits_10_1  = (unordered >> 9) & 0x3ff;
-    auto bit_20     = (unordered >> 19) & 0x1;
-    auto imm = (bits_10_1 << 1) | (bit_11 << 11) | (bits_19_12 << 12) | (bit_20 << 20);
-    instr->setImm(sext(imm, width_j_imm+1));
-  } break;   
-
-  default:
-    std::abort();
-  }
+  // extract the operands of the entry's format
+  sc_instSpecs[id].decode(code, instr);
 
-  return instr;
-}
\ No newline at end of file
+  return true;
+}
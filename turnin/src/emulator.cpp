@@ -30,7 +30,9 @@ using namespace tinyrv;
 
 Emulator::Emulator(Core* core) 
   : core_(core)
-  , reg_file_(NUM_REGS) {
+  , reg_file_(NUM_REGS)
+  , decode_cache_(DECODE_CACHE_SIZE) {
+  static_assert(ispow2(DECODE_CACHE_SIZE), "invalid decode cache size");
     this->clear();
 }
 
@@ -43,41 +45,70 @@ void Emulator::clear() {
   csrs_.clear();
   cout_buf_.clear();
   uui_gen_.reset();
+  fetch_seq_ = 0;
   perf_stats_ = PerfStats();  
   exited_ = false;
+  for (auto& entry : decode_cache_) {
+    entry.valid = false;
+  }
 }
 
 void Emulator::attach_ram(RAM* ram) {
   mmu_.attach(*ram, 0, 0xFFFFFFFF);
 }
 
+const Emulator::decode_entry_t& Emulator::fetch_decode() {
+  // lookup the decoded instruction cache
+  auto& entry = decode_cache_[(PC_ >> 2) & (DECODE_CACHE_SIZE - 1)];
+  if (entry.valid && entry.PC == PC_)
+    return entry;
+
+  // fetch
+  uint32_t instr_code = 0;
+  this->icache_read(&instr_code, PC_, sizeof(uint32_t));
+
+  // decode
+  if (!this->decode(instr_code, &entry.instr)) {
+    std::cout << std::hex << "Error: invalid instruction 0x" << instr_code << ", at PC=0x" << PC_ << std::endl;
+    std::abort();
+  }
+  entry.handler = resolve_handler(entry.instr);
+  entry.PC    = PC_;
+  entry.code  = instr_code;
+  entry.valid = true;
+
+  return entry;
+}
+
+void Emulator::invalidate_decode(uint64_t addr, uint32_t size) {
+  // drop cached instructions overlapping the written bytes
+  for (uint64_t a = addr & ~uint64_t(3); a < addr + size; a += 4) {
+    auto& entry = decode_cache_[(a >> 2) & (DECODE_CACHE_SIZE - 1)];
+    if (entry.PC == a) {
+      entry.valid = false;
+    }
+  }
+}
+
 pipeline_trace_t* Emulator::step() {
 #ifndef NDEBUG
   uint32_t uuid = uui_gen_.get_uuid(PC_);
 #else
-  uint64_t uuid = 0;
+  uint64_t uuid = fetch_seq_++;
 #endif
   
   DPH(1, "Fetch: PC=0x" << std::hex << PC_ << " (#" << std::dec << uuid << ")" << std::endl);
 
-  // fetch
-  uint32_t instr_code = 0;
-  this->icache_read(&instr_code, PC_, sizeof(uint32_t));
-
-  // decode
-  auto instr = this->decode(instr_code);
-  if (!instr) {
-    std::cout << std::hex << "Error: invalid instruction 0x" << instr_code << ", at PC=0x" << PC_ << " (#" << std::dec << uuid << ")" << std::endl;
-    std::abort();
-  }  
+  // fetch and decode
+  auto& entry = this->fetch_decode();
 
-  DP(1, "Instr 0x" << std::hex << instr_code << ": " << *instr);
+  DP(1, "Instr 0x" << std::hex << entry.code << ": " << entry.instr);
 
   // create a new instruction trace
-  auto trace = new pipeline_trace_t(uuid, PC_);
+  auto trace = core_->trace_pool_.allocate(uuid, PC_);
     
   // execute
-  this->execute(*instr, trace);
+  entry.handler(this, entry.instr, trace);
 
   DP(5, "Register File:");
   for (uint32_t i = 0; i < NUM_REGS; ++i) {
@@ -88,6 +119,44 @@ pipeline_trace_t* Emulator::step() {
   return trace;
 }
 
+// Functional-only execution of up to count instructions, stopping at exit.
+// Architectural state stays in reg_file_/PC_, so the timing model can
+// resume from where this left off with the next step().
+uint64_t Emulator::fast_forward(uint64_t count) {
+  pipeline_trace_t trace(0, 0);
+  uint64_t executed = 0;
+  while (executed < count && !exited_) {
+    auto& entry = this->fetch_decode();
+    entry.handler(this, entry.instr, &trace);
+    ++executed;
+  }
+  return executed;
+}
+
+// System instructions read timing state (cycle/instret CSRs) or end
+// the program, so they must execute in order with the timing model.
+bool Emulator::sync_point() {
+  return (this->fetch_decode().instr.getOpcode() == Opcode::SYS);
+}
+
+void Emulator::snapshot(snapshot_t* snapshot) const {
+  snapshot->reg_file = reg_file_;
+  snapshot->csrs     = csrs_;
+  snapshot->PC       = PC_;
+  snapshot->exited   = exited_;
+}
+
+void Emulator::restore(const snapshot_t& snapshot) {
+  reg_file_ = snapshot.reg_file;
+  csrs_     = snapshot.csrs;
+  PC_       = snapshot.PC;
+  exited_   = snapshot.exited;
+  // memory may hold different code now
+  for (auto& entry : decode_cache_) {
+    entry.valid = false;
+  }
+}
+
 void Emulator::trigger_ecall() {
   exited_ = true;
 }
@@ -128,6 +197,7 @@ void Emulator::dcache_write(const void* data, uint64_t addr, uint32_t size) {
      this->writeToStdOut(data);
   } else {
     mmu_.write(data, addr, size, 0);
+    this->invalidate_decode(addr, size);
   }
   DPH(2, "Mem Write: addr=0x" << std::hex << addr << ", data=0x" << ByteStream(data, size) << " (size=" << size << ", type=" << type << ")" << std::endl);  
 }
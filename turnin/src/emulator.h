@@ -18,10 +18,10 @@
 #include <sstream>
 #include <mem.h>
 #include "types.h"
+#include "instr.h"
 
 namespace tinyrv {
 
-class Instr;
 class pipeline_trace_t;
 class Core;
 
@@ -36,6 +36,14 @@ public:
     {}
   };
 
+  // architectural state
+  struct snapshot_t {
+    std::vector<Word> reg_file;
+    CSRs  csrs;
+    Word  PC;
+    bool  exited;
+  };
+
   Emulator(Core* core);
   ~Emulator();
 
@@ -47,16 +55,80 @@ public:
 
   pipeline_trace_t* step();
 
+  uint64_t fast_forward(uint64_t count);
+
+  bool sync_point();
+
+  void snapshot(snapshot_t* snapshot) const;
+
+  void restore(const snapshot_t& snapshot);
+
   bool check_exit(Word* exitcode, bool riscv_test) const;
 
 private:
 
-  std::shared_ptr<Instr> decode(uint32_t code) const;
+  typedef void (*exec_handler_t)(Emulator*, const Instr&, pipeline_trace_t*);
+
+  struct decode_entry_t {
+    Instr    instr;
+    exec_handler_t handler;
+    Word     PC;
+    uint32_t code;
+    bool     valid;
+  };
+
+  bool decode(uint32_t code, Instr* instr) const;
+
+  const decode_entry_t& fetch_decode();
+
+  void invalidate_decode(uint64_t addr, uint32_t size);
 
   pipeline_trace_t* execute(const Instr &instr);
 
   void execute(const Instr &instr, pipeline_trace_t *trace);
 
+  static exec_handler_t resolve_handler(const Instr &instr);
+
+  static void exec_traced(Emulator* emu, const Instr &instr, pipeline_trace_t *trace);
+
+  template <typename Op>
+  static void exec_alu_r(Emulator* emu, const Instr &instr, pipeline_trace_t *trace);
+
+  template <typename Op>
+  static void exec_alu_i(Emulator* emu, const Instr &instr, pipeline_trace_t *trace);
+
+  template <bool PCRel>
+  static void exec_upper(Emulator* emu, const Instr &instr, pipeline_trace_t *trace);
+
+  template <typename Cond>
+  static void exec_branch(Emulator* emu, const Instr &instr, pipeline_trace_t *trace);
+
+  static void exec_jal(Emulator* emu, const Instr &instr, pipeline_trace_t *trace);
+
+  static void exec_jalr(Emulator* emu, const Instr &instr, pipeline_trace_t *trace);
+
+  template <uint32_t Bytes, bool Signed>
+  static void exec_load(Emulator* emu, const Instr &instr, pipeline_trace_t *trace);
+
+  template <uint32_t Bytes>
+  static void exec_store(Emulator* emu, const Instr &instr, pipeline_trace_t *trace);
+
+  static void exec_fence(Emulator* emu, const Instr &instr, pipeline_trace_t *trace);
+
+  static void exec_ecall(Emulator* emu, const Instr &instr, pipeline_trace_t *trace);
+
+  static void exec_ebreak(Emulator* emu, const Instr &instr, pipeline_trace_t *trace);
+
+  static void exec_xret(Emulator* emu, const Instr &instr, pipeline_trace_t *trace);
+
+  template <CSROp Op, bool Imm>
+  static void exec_csr(Emulator* emu, const Instr &instr, pipeline_trace_t *trace);
+
+  // handlers of the instruction table entries
+  static const exec_handler_t sc_handlers[];
+
+  void writeback(const Instr &instr, pipeline_trace_t *trace, Word value);
+
   void icache_read(void* data, uint64_t addr, uint32_t size);
 
   void dcache_read(void* data, uint64_t addr, uint32_t size);
@@ -78,6 +150,7 @@ private:
   Core* core_;
 
   std::vector<Word> reg_file_;
+  std::vector<decode_entry_t> decode_cache_;
   MemoryUnit mmu_;
   CSRs csrs_;
   Word PC_;
@@ -86,6 +159,9 @@ private:
   
   UUIDGenerator uui_gen_;
 
+  // release builds number the fetched instructions in order
+  uint64_t fetch_seq_;
+
   bool exited_;
 
   PerfStats perf_stats_;
@@ -0,0 +1,60 @@
+// Copyright 2024 Blaise Tine
+//
+// Licensed under the Apache License;
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Offline decoder for the binary event log, prints the TRACE text format.
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include "eventlog.h"
+
+using namespace tinyrv;
+
+int main(int argc, char **argv) {
+  if (argc != 2) {
+    std::cout << "Usage: evdump <event log>" << std::endl;
+    return -1;
+  }
+
+  std::ifstream ifs(argv[1], std::ios::binary);
+  if (!ifs) {
+    std::cout << "error: " << argv[1] << " not found" << std::endl;
+    return -1;
+  }
+
+  event_log_header_t header;
+  if (!ifs.read((char*)&header, sizeof(header))
+   || header.magic != EVENT_LOG_MAGIC 
+   || header.version != EVENT_LOG_VERSION
+   || header.record_size != sizeof(event_record_t)) {
+    std::cout << "error: invalid event log " << argv[1] << std::endl;
+    return -1;
+  }
+
+  event_record_t rec;
+  uint64_t cycle = 0;
+  while (ifs.read((char*)&rec, sizeof(rec))) {
+    cycle += rec.cycles;
+    pipeline_trace_t trace(rec.uuid, rec.PC);
+    trace.rd      = rec.info & 0x1f;
+    trace.wb      = (rec.info >> 5) & 0x1;
+    trace.fu_type = FUType(rec.info >> 6);
+    // expand the stall runs, one line per cycle
+    for (uint32_t i = 0; i < rec.count; ++i) {
+      std::cout TRACE_HEADER << std::setw(10) << std::dec << (cycle + i) << std::setw(0) << ": " 
+                << event_name(rec.code) << ": " << trace << std::endl;
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,65 @@
+// Copyright 2024 Blaise Tine
+//
+// Licensed under the Apache License;
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <iostream>
+#include <stdlib.h>
+#include "eventlog.h"
+
+using namespace tinyrv;
+
+void EventLog::open(const char* filename, uint32_t mask) {
+  ofs_.open(filename, std::ios::binary);
+  if (!ofs_) {
+    std::cout << "error: cannot create event log " << filename << std::endl;
+    std::abort();
+  }
+  event_log_header_t header{EVENT_LOG_MAGIC, EVENT_LOG_VERSION, sizeof(event_record_t), mask};
+  ofs_.write((const char*)&header, sizeof(header));
+  buffer_.resize(EVENT_LOG_SIZE);
+  last_cycle_ = 0;
+  size_ = 0;
+  mask_ = mask;
+}
+
+void EventLog::close() {
+  if (!ofs_.is_open())
+    return;
+  this->flush();
+  ofs_.close();
+  mask_ = 0;
+}
+
+void EventLog::flush() {
+  ofs_.write((const char*)buffer_.data(), size_ * sizeof(event_record_t));
+  size_ = 0;
+}
+
+void EventLog::record_long(EventCode code, const pipeline_trace_t& trace, uint64_t cycle, uint64_t count) {
+  // pad a cycle gap too long for one delta
+  while (cycle - last_cycle_ > 0xffffffff) {
+    auto& rec = buffer_[size_];
+    rec = event_record_t();
+    rec.cycles = 0xffffffff;
+    last_cycle_ += 0xffffffff;
+    if (++size_ == EVENT_LOG_SIZE) {
+      this->flush();
+    }
+  }
+  // split a run too long for one count
+  while (count > EVENT_MAX_COUNT) {
+    this->record(code, trace, cycle, EVENT_MAX_COUNT);
+    cycle += EVENT_MAX_COUNT;
+    count -= EVENT_MAX_COUNT;
+  }
+  this->record(code, trace, cycle, count);
+}
@@ -0,0 +1,148 @@
+// Copyright 2024 Blaise Tine
+//
+// Licensed under the Apache License;
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <fstream>
+#include <simobject.h>
+#include "types.h"
+#include "trace.h"
+
+#define EVENT_LOG_MAGIC   0x45565254 // "TRVE"
+#define EVENT_LOG_VERSION 2
+
+namespace tinyrv {
+
+// pipeline events, the bit position in the runtime mask
+enum class EventCode : uint8_t {
+  BRANCH_STALL,
+  ISSUE_STALL,
+  ISSUE,
+  EXECUTE,
+  WRITEBACK,
+  COMMIT,
+  MAX
+};
+
+inline const char* event_name(uint32_t code) {
+  static const char* names[] = {
+    "*** branch stalled!",
+    "*** issue stalled!",
+    "pipeline-issue",
+    "pipeline-execute",
+    "pipeline-writeback",
+    "pipeline-commit"
+  };
+  return (code < uint32_t(EventCode::MAX)) ? names[code] : "unknown";
+}
+
+struct event_log_header_t {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t record_size;
+  uint32_t mask;
+};
+
+// 16-byte record, the cycle is a delta from the previous record's and
+// a stall held over consecutive cycles is a single record with a count
+struct event_record_t {
+  uint32_t cycles;  // cycles since the previous record
+  uint32_t uuid;    // low bits of the instruction identifier
+  Word     PC;
+  uint16_t count;   // consecutive cycles the event repeats, 0 for a padding record
+  uint8_t  code;
+  uint8_t  info;    // rd[4:0], wb[5], fu_type[7:6]
+};
+
+#define EVENT_MAX_COUNT 0xffff
+
+static_assert(sizeof(event_record_t) == 16, "invalid event record size");
+static_assert(NUM_FUS <= 4, "fu_type does not fit the event record");
+
+// Binary pipeline event log for release builds.
+// Records are staged in a fixed ring and written out when it fills up,
+// the runtime mask selects the events, with a zero mask costing a test.
+class EventLog {
+public:
+  static EventLog& instance() {
+    static EventLog log;
+    return log;
+  }
+
+  void open(const char* filename, uint32_t mask);
+
+  void close();
+
+  uint32_t mask() const {
+    return mask_;
+  }
+
+  // record an event repeating over count cycles from the given one
+  void record(EventCode code, const pipeline_trace_t& trace, uint64_t cycle, uint64_t count = 1) {
+    auto delta = cycle - last_cycle_;
+    if (delta > 0xffffffff || count > EVENT_MAX_COUNT) {
+      this->record_long(code, trace, cycle, count);
+      return;
+    }
+    if (size_ != 0) {
+      // extend the previous record when the same event carries on
+      auto& prev = buffer_[size_ - 1];
+      if (delta == prev.count
+       && prev.code == uint8_t(code)
+       && prev.uuid == uint32_t(trace.uuid)
+       && prev.count + count <= EVENT_MAX_COUNT) {
+        prev.count += count;
+        return;
+      }
+    }
+    last_cycle_ = cycle;
+    auto& rec = buffer_[size_];
+    rec.cycles = uint32_t(delta);
+    rec.uuid   = uint32_t(trace.uuid);
+    rec.PC     = trace.PC;
+    rec.count  = uint16_t(count);
+    rec.code   = uint8_t(code);
+    rec.info   = trace.rd | (trace.wb << 5) | (uint32_t(trace.fu_type) << 6);
+    if (++size_ == EVENT_LOG_SIZE) {
+      this->flush();
+    }
+  }
+
+private:
+
+  EventLog() : last_cycle_(0), size_(0), mask_(0) {}
+
+  ~EventLog() {
+    this->close();
+  }
+
+  void flush();
+
+  void record_long(EventCode code, const pipeline_trace_t& trace, uint64_t cycle, uint64_t count);
+
+  std::vector<event_record_t> buffer_;
+  uint64_t last_cycle_;
+  uint32_t size_;
+  uint32_t mask_;
+  std::ofstream ofs_;
+};
+
+}
+
+#define EL(code, trace) do { \
+  if (EventLog::instance().mask() & (1u << uint32_t(EventCode::code))) { \
+    EventLog::instance().record(EventCode::code, trace, this->platform().cycles()); \
+  } \
+} while(0)
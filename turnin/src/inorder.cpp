@@ -14,11 +14,14 @@
 
 #include "inorder.h"
 #include "core.h"
+#include "core_variant.h"
 
 using namespace tinyrv;
 
-InorderPipeline::InorderPipeline(Core* core) 
-  : core_(core) {
+InorderPipeline::InorderPipeline(Core* core, const ProcessorConfig& /*config*/) 
+  : core_(core)
+  , issue_latch_(LATCH_SIZE)
+  , wb_latch_(LATCH_SIZE) {
   //--
 }
 
@@ -26,13 +29,25 @@ InorderPipeline::~InorderPipeline() {
   //--
 }
 
-bool InorderPipeline::issue(pipeline_trace_t* trace) {
+void InorderPipeline::reset() {
+  issue_latch_.clear();
+  wb_latch_.clear();
+  inuse_.reset();
+}
+
+bool InorderPipeline::has_hazard(const pipeline_trace_t* trace) const {
   // check RAW and WAW data dependencies
   if (trace->rs1 != 0 && inuse_.test(trace->rs1))
-    return false;
+    return true;
   if (trace->rs2 != 0 && inuse_.test(trace->rs2))
-    return false;
+    return true;
   if (trace->rd != 0 && inuse_.test(trace->rd))
+    return true;
+  return false;
+}
+
+bool InorderPipeline::issue(pipeline_trace_t* trace) {
+  if (issue_latch_.full() || this->has_hazard(trace))
     return false;
   
   // mark destination register as in use
@@ -45,24 +60,24 @@ bool InorderPipeline::issue(pipeline_trace_t* trace) {
   return true;
 }
 
-std::vector<pipeline_trace_t*> InorderPipeline::execute() {
-  std::vector<pipeline_trace_t*> traces;
+void InorderPipeline::execute(TraceBuffer* traces) {
   auto& FUs = core_->FUs_;
 
   if (!issue_latch_.empty()) {
     auto trace = issue_latch_.front();    
     FUs.at((int)trace->fu_type)->Input.send({trace, 0, 0});  
-    traces.push_back(trace);
+    traces->push(trace);
     issue_latch_.pop();
   }
-  
-  return traces;
 }
 
 pipeline_trace_t* InorderPipeline::writeback() {
   pipeline_trace_t* trace = nullptr;
   auto& FUs = core_->FUs_;
 
+  if (wb_latch_.full())
+    return nullptr;
+
   for (auto& fu : FUs) {
     if (fu->Output.empty())
       continue;
@@ -92,6 +107,22 @@ pipeline_trace_t* InorderPipeline::commit() {
   return trace;
 }
 
+bool InorderPipeline::idle(const pipeline_trace_t* trace) const {
+  if (!issue_latch_.empty() || !wb_latch_.empty())
+    return false;
+  for (auto& fu : core_->FUs_) {
+    if (!fu->Output.empty())
+      return false;
+  }
+  return this->has_hazard(trace);
+}
+
 void InorderPipeline::dump() {
   //--
-}
\ No newline at end of file
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+// the core variants are instantiated with their pipeline for inlining
+template class tinyrv::CoreVariant<InorderPipeline, NoPredictor>;
+template class tinyrv::CoreVariant<InorderPipeline, GShare>;
@@ -18,25 +18,37 @@
 namespace tinyrv {
 
 struct pipeline_trace_t;
+struct ProcessorConfig;
 class Core;
 
-class InorderPipeline : public Pipeline {
+class InorderPipeline {
 public:
-  InorderPipeline(Core* core);
+  InorderPipeline(Core* core, const ProcessorConfig& config);
 
   ~InorderPipeline();
 
-  bool issue(pipeline_trace_t* trace) override;
+  uint32_t execute_width() const {
+    return 1;
+  }
 
-  std::vector<pipeline_trace_t*> execute() override;
+  void reset();
 
-  pipeline_trace_t* writeback() override;
+  bool issue(pipeline_trace_t* trace);
 
-  pipeline_trace_t* commit() override;
+  void execute(TraceBuffer* traces);
 
-  void dump() override;
+  pipeline_trace_t* writeback();
+
+  pipeline_trace_t* commit();
+
+  bool idle(const pipeline_trace_t* trace) const;
+
+  void dump();
 
 private:
+
+  bool has_hazard(const pipeline_trace_t* trace) const;
+
   Core*         core_;
   PipelineLatch issue_latch_;
   PipelineLatch wb_latch_;
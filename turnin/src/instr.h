@@ -17,7 +17,7 @@
 
 namespace tinyrv {
 
-enum class Opcode {   
+enum class Opcode : uint8_t {   
   NONE  = 0x0,    
   R     = 0x33,
   L     = 0x3,
@@ -32,23 +32,98 @@ enum class Opcode {
   FENCE = 0x0f,
 };
 
-enum class InstType {
+// operand layout of an encoding, each has its own field extractor
+enum class InstType : uint8_t {
   R, 
   I, 
+  I_SHAMT,  // shift amount immediate
+  I_CSR,    // CSR address, rs1 source
+  I_CSRI,   // CSR address, 5-bit immediate source
+  I_SYS,    // raw immediate, no registers
   S, 
   B, 
   U, 
   J,
 };
 
+// RV32 instruction specification table, the single source for decoding,
+// disassembly and execution dispatch:
+//   X(mnemonic, format, match, mask, handler)
+// An encoding matches an entry if (code & mask) == match, its operands are
+// extracted according to its format and it executes with its handler.
+// Entries sharing an opcode must be contiguous.
+#define RV32_INSTR_TABLE(X) \
+  X("LUI",    U,       0x00000037, 0x0000007f, exec_upper<false>) \
+  X("AUIPC",  U,       0x00000017, 0x0000007f, exec_upper<true>) \
+  X("JAL",    J,       0x0000006f, 0x0000007f, exec_jal) \
+  X("JALR",   I,       0x00000067, 0x0000707f, exec_jalr) \
+  X("BEQ",    B,       0x00000063, 0x0000707f, exec_branch<cond_eq>) \
+  X("BNE",    B,       0x00001063, 0x0000707f, exec_branch<cond_ne>) \
+  X("BLT",    B,       0x00004063, 0x0000707f, exec_branch<cond_lt>) \
+  X("BGE",    B,       0x00005063, 0x0000707f, exec_branch<cond_ge>) \
+  X("BLTU",   B,       0x00006063, 0x0000707f, exec_branch<cond_ltu>) \
+  X("BGEU",   B,       0x00007063, 0x0000707f, exec_branch<cond_geu>) \
+  X("LB",     I,       0x00000003, 0x0000707f, exec_load<1, true>) \
+  X("LH",     I,       0x00001003, 0x0000707f, exec_load<2, true>) \
+  X("LW",     I,       0x00002003, 0x0000707f, exec_load<4, true>) \
+  X("LBU",    I,       0x00004003, 0x0000707f, exec_load<1, false>) \
+  X("LHU",    I,       0x00005003, 0x0000707f, exec_load<2, false>) \
+  X("SB",     S,       0x00000023, 0x0000707f, exec_store<1>) \
+  X("SH",     S,       0x00001023, 0x0000707f, exec_store<2>) \
+  X("SW",     S,       0x00002023, 0x0000707f, exec_store<4>) \
+  X("ADDI",   I,       0x00000013, 0x0000707f, exec_alu_i<op_add>) \
+  X("SLLI",   I_SHAMT, 0x00001013, 0xfe00707f, exec_alu_i<op_sll>) \
+  X("SLTI",   I,       0x00002013, 0x0000707f, exec_alu_i<op_slt>) \
+  X("SLTIU",  I,       0x00003013, 0x0000707f, exec_alu_i<op_sltu>) \
+  X("XORI",   I,       0x00004013, 0x0000707f, exec_alu_i<op_xor>) \
+  X("SRLI",   I_SHAMT, 0x00005013, 0xfe00707f, exec_alu_i<op_srl>) \
+  X("SRAI",   I_SHAMT, 0x40005013, 0xfe00707f, exec_alu_i<op_sra>) \
+  X("ORI",    I,       0x00006013, 0x0000707f, exec_alu_i<op_or>) \
+  X("ANDI",   I,       0x00007013, 0x0000707f, exec_alu_i<op_and>) \
+  X("ADD",    R,       0x00000033, 0xfe00707f, exec_alu_r<op_add>) \
+  X("SUB",    R,       0x40000033, 0xfe00707f, exec_alu_r<op_sub>) \
+  X("SLL",    R,       0x00001033, 0xfe00707f, exec_alu_r<op_sll>) \
+  X("SLT",    R,       0x00002033, 0xfe00707f, exec_alu_r<op_slt>) \
+  X("SLTU",   R,       0x00003033, 0xfe00707f, exec_alu_r<op_sltu>) \
+  X("XOR",    R,       0x00004033, 0xfe00707f, exec_alu_r<op_xor>) \
+  X("SRL",    R,       0x00005033, 0xfe00707f, exec_alu_r<op_srl>) \
+  X("SRA",    R,       0x40005033, 0xfe00707f, exec_alu_r<op_sra>) \
+  X("OR",     R,       0x00006033, 0xfe00707f, exec_alu_r<op_or>) \
+  X("AND",    R,       0x00007033, 0xfe00707f, exec_alu_r<op_and>) \
+  X("MUL",    R,       0x02000033, 0xfe00707f, exec_alu_r<op_mul>) \
+  X("MULH",   R,       0x02001033, 0xfe00707f, exec_alu_r<op_mulh>) \
+  X("MULHSU", R,       0x02002033, 0xfe00707f, exec_alu_r<op_mulhsu>) \
+  X("MULHU",  R,       0x02003033, 0xfe00707f, exec_alu_r<op_mulhu>) \
+  X("DIV",    R,       0x02004033, 0xfe00707f, exec_alu_r<op_div>) \
+  X("DIVU",   R,       0x02005033, 0xfe00707f, exec_alu_r<op_divu>) \
+  X("REM",    R,       0x02006033, 0xfe00707f, exec_alu_r<op_rem>) \
+  X("REMU",   R,       0x02007033, 0xfe00707f, exec_alu_r<op_remu>) \
+  X("FENCE",  I_SYS,   0x0000000f, 0x0000007f, exec_fence) \
+  X("ECALL",  I_SYS,   0x00000073, 0xfff0707f, exec_ecall) \
+  X("EBREAK", I_SYS,   0x00100073, 0xfff0707f, exec_ebreak) \
+  X("URET",   I_SYS,   0x00200073, 0xfff0707f, exec_xret) \
+  X("SRET",   I_SYS,   0x10200073, 0xfff0707f, exec_xret) \
+  X("MRET",   I_SYS,   0x30200073, 0xfff0707f, exec_xret) \
+  X("CSRRW",  I_CSR,   0x00001073, 0x0000707f, exec_csr<CSROp::CSRRW, false>) \
+  X("CSRRS",  I_CSR,   0x00002073, 0x0000707f, exec_csr<CSROp::CSRRS, false>) \
+  X("CSRRC",  I_CSR,   0x00003073, 0x0000707f, exec_csr<CSROp::CSRRC, false>) \
+  X("CSRRWI", I_CSRI,  0x00005073, 0x0000707f, exec_csr<CSROp::CSRRW, true>) \
+  X("CSRRSI", I_CSRI,  0x00006073, 0x0000707f, exec_csr<CSROp::CSRRS, true>) \
+  X("CSRRCI", I_CSRI,  0x00007073, 0x0000707f, exec_csr<CSROp::CSRRC, true>)
+
+enum {
+  INSTR_ID_NONE = 0xff
+};
+
 class Instr {
 public:
   Instr() 
     : opcode_(Opcode::NONE)
+    , id_(INSTR_ID_NONE)
     , num_rsrcs_(0)
     , has_imm_(false)
-    , rdest_type_(RegType::None)
     , imm_(0)
+    , rdest_type_(RegType::None)
     , rdest_(0)
     , func3_(0)
     , func7_(0) {
@@ -62,6 +137,10 @@ public:
     opcode_ = opcode; 
   }
 
+  void setId(uint32_t id) { 
+    id_ = id; 
+  }
+
   void setDestReg(uint32_t destReg, RegType type) { 
     rdest_type_ = type; 
     rdest_ = destReg; 
@@ -84,6 +163,7 @@ public:
   void setImm(uint32_t imm) { has_imm_ = true; imm_ = imm; }
 
   Opcode   getOpcode() const { return opcode_; }
+  uint32_t getId() const { return id_; }
   uint32_t getFunc3() const { return func3_; }
   uint32_t getFunc7() const { return func7_; }
   uint32_t getNRSrc() const { return num_rsrcs_; }
@@ -101,15 +181,16 @@ private:
   };
 
   Opcode opcode_;
-  uint32_t num_rsrcs_;
+  uint8_t id_;
+  uint8_t num_rsrcs_;
   bool has_imm_;
-  RegType rdest_type_;
   uint32_t imm_;
+  RegType rdest_type_;
   RegType rsrc_type_[MAX_REG_SOURCES];
-  uint32_t rsrc_[MAX_REG_SOURCES];  
-  uint32_t rdest_;
-  uint32_t func3_;
-  uint32_t func7_;
+  uint8_t rsrc_[MAX_REG_SOURCES];  
+  uint8_t rdest_;
+  uint8_t func3_;
+  uint8_t func7_;
 
   friend std::ostream &operator<<(std::ostream &, const Instr&);
 };
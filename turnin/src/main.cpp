@@ -19,34 +19,103 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <sys/stat.h>
+#include <sys/resource.h>
+#include <chrono>
+#include <thread>
 #include <util.h>
 #include "processor.h"
 #include "mem.h"
 #include "core.h"
+#include "eventlog.h"
+#include "tracechannel.h"
 
 using namespace tinyrv;
 
 static void show_usage() {
-   std::cout << "Usage: [-g: gshare] [-o: ooo] [-s: stats] [-h: help] <program>" << std::endl;
+   std::cout << "Usage: [-g: gshare] [-o: ooo] [-A: async emulator] [-s: stats] [-H: host stats] [-F <n>: fast-forward n instrs] [-W <n>: warm-up n instrs] [-S <n>: sampling period] [-U <n>: sampling unit] [-T <file>: record trace] [-R <file>: replay trace] [-m: sparse memory] [-L <file>: event log] [-M <mask>: event mask] [-C <configs>: broadcast to configs] [-x <n>: max cycles, 0: none (-C default: " << MAX_CYCLES << ")] [-h: help] <program>" << std::endl;
 }
 
 bool showStats = false;
+bool showHostStats = false;
 const char* program = nullptr;
-bool gshare_enabled = false;
-bool ooo_enabled = false;
+ProcessorConfig config;
+uint64_t ff_instrs = 0;
+uint64_t warmup_instrs = 0;
+uint64_t sample_period = 0;
+uint64_t sample_unit = 1000;
+const char* trace_out = nullptr;
+const char* trace_in = nullptr;
+bool sparse_ram = false;
+const char* event_log = nullptr;
+uint32_t event_mask = (1u << uint32_t(EventCode::MAX)) - 1;
+std::vector<std::string> broadcast_specs;
+std::vector<ProcessorConfig> broadcast_configs;
+uint64_t max_cycles = 0;
+bool max_cycles_set = false;
 
 static void parse_args(int argc, char **argv) {
   	int c;
-  	while ((c = getopt(argc, argv, "ogsh?")) != -1) {
+  	while ((c = getopt(argc, argv, "ogAsHmF:W:S:U:T:R:L:M:C:x:h?")) != -1) {
     	switch (c) {
       case 's':
         showStats = true;
         break;
+      case 'H':
+        showHostStats = true;
+        break;
     	case 'o':
-        ooo_enabled = true;
+        config.ooo_enabled = true;
         break;
       case 'g':
-        gshare_enabled = true;
+        config.gshare_enabled = true;
+        break;
+      case 'A':
+        config.emu_async = true;
+        break;
+      case 'm':
+        sparse_ram = true;
+        break;
+      case 'F':
+        ff_instrs = std::strtoull(optarg, nullptr, 0);
+        break;
+      case 'W':
+        warmup_instrs = std::strtoull(optarg, nullptr, 0);
+        break;
+      case 'S':
+        sample_period = std::strtoull(optarg, nullptr, 0);
+        break;
+      case 'U':
+        sample_unit = std::strtoull(optarg, nullptr, 0);
+        break;
+      case 'T':
+        trace_out = optarg;
+        break;
+      case 'R':
+        trace_in = optarg;
+        break;
+      case 'L':
+        event_log = optarg;
+        break;
+      case 'M':
+        event_mask = std::strtoul(optarg, nullptr, 0);
+        break;
+      case 'C': {
+        std::stringstream ss(optarg);
+        std::string spec;
+        while (std::getline(ss, spec, ',')) {
+          ProcessorConfig config;
+          if (!config.parse(spec)) {
+            std::cout << "*** error: invalid config '" << spec << "'." << std::endl;
+            exit(-1);
+          }
+          broadcast_specs.push_back(spec);
+          broadcast_configs.push_back(config);
+        }
+        break;
+      }
+      case 'x':
+        max_cycles = std::strtoull(optarg, nullptr, 0);
+        max_cycles_set = true;
         break;
       case 'h':
     	case '?':
@@ -59,7 +128,40 @@ static void parse_args(int argc, char **argv) {
     	}
 	}
 
-	if (optind < argc) {
+  if (sample_unit == 0 || (sample_period != 0 && sample_period < sample_unit)) {
+    // every sample must measure at least one instruction within its period
+    std::cout << "*** error: -U must be nonzero and no larger than -S." << std::endl;
+    exit(-1);
+  }
+
+  if (!broadcast_configs.empty()
+   && (trace_in || trace_out || ff_instrs || sample_period || event_log)) {
+    // the timing models only see the broadcast stream
+    std::cout << "*** error: -C cannot be combined with -R, -T, -F, -S or -L." << std::endl;
+    exit(-1);
+  }
+
+  if (!broadcast_configs.empty()
+   && (config.ooo_enabled || config.gshare_enabled || config.emu_async)) {
+    // each configuration sets its own mode
+    std::cout << "*** error: -C cannot be combined with -o, -g or -A." << std::endl;
+    exit(-1);
+  }
+
+  if (trace_out && sample_period) {
+    // the trace would only hold the sampled windows
+    std::cout << "*** error: -T cannot be combined with -S." << std::endl;
+    exit(-1);
+  }
+
+	if (trace_in) {
+    // replay runs without a program, functional modes need the emulator
+    if (trace_out || ff_instrs || sample_period) {
+      std::cout << "*** error: -R cannot be combined with -T, -F or -S." << std::endl;
+      exit(-1);
+    }
+    std::cout << "Replaying " << trace_in << ".." << std::endl;
+  } else if (optind < argc) {
 		program = argv[optind];
     std::cout << "Running " << program << ".." << std::endl;
 	} else {
@@ -68,6 +170,93 @@ static void parse_args(int argc, char **argv) {
 	}
 }
 
+static void show_host_stats(double seconds) {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  std::cout << "HOST: seconds=" << std::fixed << std::setprecision(6) << seconds 
+            << std::defaultfloat << ", peak_rss=" << usage.ru_maxrss << "KB" << std::endl;
+}
+
+// run the program once functionally and broadcast its instruction stream
+// to one timing model per configuration, each on its own thread
+static int run_broadcast(RAM* ram) {
+  struct result_t {
+    int      exitcode;
+    uint64_t instrs;
+    uint64_t cycles;
+  };
+
+  // one timing model that never completes would stall them all
+  uint64_t cycle_limit = max_cycles_set ? max_cycles : MAX_CYCLES;
+
+  uint32_t num_configs = broadcast_configs.size();
+  std::vector<std::shared_ptr<TraceChannel>> channels;
+  std::vector<TraceChannel*> outputs;
+  for (uint32_t i = 0; i < num_configs; ++i) {
+    channels.push_back(std::make_shared<TraceChannel>(EMU_QUEUE_SIZE));
+    outputs.push_back(channels.back().get());
+  }
+
+  auto host_start = std::chrono::steady_clock::now();
+
+  // each timing model is created, run and destroyed on its own thread
+  std::vector<result_t> results(num_configs);
+  std::vector<std::thread> threads;
+  for (uint32_t i = 0; i < num_configs; ++i) {
+    threads.emplace_back([&, i]() {
+      Processor processor(broadcast_configs[i]);
+      processor.attach_trace_source(outputs[i]);
+      processor.set_max_cycles(cycle_limit);
+      results[i].exitcode = processor.run(true, 0, warmup_instrs);
+      // a model that timed out no longer holds back the emulator
+      outputs[i]->detach();
+      processor.perf_stats(&results[i].instrs, &results[i].cycles);
+    });
+  }
+
+  int exitcode;
+  {
+    Processor processor;
+    processor.attach_ram(ram);
+    exitcode = processor.broadcast(outputs, true);
+  }
+
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  std::chrono::duration<double> host_time = std::chrono::steady_clock::now() - host_start;
+
+  for (uint32_t i = 0; i < num_configs; ++i) {
+    // the measured cycles exclude the warm-up, a model stopped
+    // short of the end of its stream was abandoned
+    if (!outputs[i]->done() || results[i].exitcode != exitcode) {
+      std::cout << "*** error: config " << broadcast_specs[i] << " timed out after " 
+                << std::dec << cycle_limit << " cycles." << std::endl;
+      exitcode = -1;
+    }
+  }
+
+  if (exitcode != 0) {
+    std::cout << "*** FAILED: exitcode=" << exitcode << std::endl;
+  } else {
+    std::cout << "PASSED!" << std::endl;
+  }
+
+  // show performance stats, one line per configuration
+  if (showStats) {
+    for (uint32_t i = 0; i < num_configs; ++i) {
+      std::cout << std::dec << "PERF: config=" << broadcast_specs[i] << ", instrs=" << results[i].instrs
+                << ", cycles=" << results[i].cycles << std::endl;
+    }
+  }
+
+  if (showHostStats) {
+    show_host_stats(host_time.count());
+  }
+
+  return exitcode;
+}
+
 int main(int argc, char **argv) {
   int exitcode = -1;
 
@@ -75,10 +264,10 @@ int main(int argc, char **argv) {
 
   {
     // create memory module
-    RAM ram(RAM_PAGE_SIZE);
+    RAM ram(RAM_PAGE_SIZE, 0, sparse_ram);
 
     // load program
-    {      
+    if (program) {
       std::string program_ext(fileExtension(program));
       if (program_ext == "bin") {
         ram.loadBinImage(program, STARTUP_ADDR);
@@ -90,14 +279,43 @@ int main(int argc, char **argv) {
       }
     }
 
+    if (!broadcast_configs.empty()) {
+      return run_broadcast(&ram);
+    }
+
     // create processor
-    Processor processor;
+    Processor processor(config);
   
     // attach memory module
     processor.attach_ram(&ram);
 
+    // configure periodic sampling
+    processor.set_sampling(sample_period, sample_unit);
+
+    // abandon a run that does not complete
+    processor.set_max_cycles(max_cycles);
+
+    // configure trace recording or replay
+    if (trace_out) {
+      processor.record_trace(trace_out);
+    }
+    if (trace_in) {
+      processor.replay_trace(trace_in);
+    }
+
+    // enable the event log
+    if (event_log) {
+      EventLog::instance().open(event_log, event_mask);
+    }
+
     // run simulation
-    exitcode = processor.run(true);
+    auto host_start = std::chrono::steady_clock::now();
+    exitcode = processor.run(true, ff_instrs, warmup_instrs);
+    std::chrono::duration<double> host_time = std::chrono::steady_clock::now() - host_start;
+
+    if (event_log) {
+      EventLog::instance().close();
+    }
     if (exitcode != 0) {
       std::cout << "*** FAILED: exitcode=" << exitcode << std::endl;
     } else {
@@ -108,6 +326,12 @@ int main(int argc, char **argv) {
     if (showStats) {
       processor.showStats();
     }
+
+    // show simulation time and peak memory of the host
+    if (showHostStats) {
+      show_host_stats(host_time.count());
+      processor.showAllocStats();
+    }
   }
 
   return exitcode;
@@ -15,22 +15,34 @@
 #pragma once
 
 #include <memory>
+#include <vector>
 #include <iostream>
+#include <assert.h>
 #include <util.h>
+#include <ringbuffer.h>
 #include "types.h"
 #include "trace.h"
 
 namespace tinyrv {
 
+// Fixed-size FIFO between two stages, the producer checks full() and
+// stalls, so the latch never allocates after construction.
 class PipelineLatch {
 public:
-  PipelineLatch() {}
+  PipelineLatch(uint32_t size) 
+    : queue_(size)
+  {}
+  
   ~PipelineLatch() {}
   
   bool empty() const {
     return queue_.empty();
   }
 
+  bool full() const {
+    return queue_.full();
+  }
+
   pipeline_trace_t* front() {
     return queue_.front();
   }
@@ -39,7 +51,8 @@ public:
     return queue_.back();
   }
 
-  void push(pipeline_trace_t* value) {    
+  void push(pipeline_trace_t* value) {
+    assert(!queue_.full());
     queue_.push(value);
   }
 
@@ -48,30 +61,76 @@ public:
   }
 
   void clear() {
-    std::queue<pipeline_trace_t*> empty;
-    std::swap(queue_, empty );
+    queue_.clear();
   }
 
 protected:
-  std::queue<pipeline_trace_t*> queue_;
+  RingBuffer<pipeline_trace_t*> queue_;
 };
 
 ///////////////////////////////////////////////////////////////////////////////
 
-class Pipeline {
+// Traces a stage processed this cycle, owned by the caller and reused
+// every cycle. The capacity is fixed at construction.
+class TraceBuffer {
 public:
-  Pipeline() {}
-  virtual ~Pipeline() {}
+  TraceBuffer(uint32_t capacity) 
+    : store_(capacity)
+    , size_(0)
+  {}
+
+  void clear() {
+    size_ = 0;
+  }
+
+  void push(pipeline_trace_t* trace) {
+    assert(size_ < store_.size());
+    store_[size_++] = trace;
+  }
+
+  bool empty() const {
+    return (0 == size_);
+  }
 
-  virtual bool issue(pipeline_trace_t* trace) = 0;
+  uint32_t size() const {
+    return size_;
+  }
 
-  virtual std::vector<pipeline_trace_t*> execute() = 0;
+  pipeline_trace_t* operator[](uint32_t index) const {
+    return store_[index];
+  }
 
-  virtual pipeline_trace_t* writeback() = 0;
+  pipeline_trace_t* const* begin() const {
+    return store_.data();
+  }
 
-  virtual pipeline_trace_t* commit() = 0;
+  pipeline_trace_t* const* end() const {
+    return store_.data() + size_;
+  }
 
-  virtual void dump() = 0;
+private:
+  std::vector<pipeline_trace_t*> store_;
+  uint32_t size_;
 };
 
+///////////////////////////////////////////////////////////////////////////////
+
+// The pipeline models have no common base class: the core is templated on
+// its pipeline, so the stages are called directly from the tick loop and
+// can be inlined. A pipeline model provides:
+//
+//   Pipeline(Core* core, const ProcessorConfig& config);
+//   // most traces execute() can dispatch in a cycle
+//   uint32_t execute_width() const;
+//   void reset();
+//   bool issue(pipeline_trace_t* trace);
+//   // append the dispatched traces to the caller's buffer
+//   void execute(TraceBuffer* traces);
+//   pipeline_trace_t* writeback();
+//   pipeline_trace_t* commit();
+//   // return true if no stage has work this cycle and the given
+//   // stalled trace cannot issue until a pending event fires
+//   bool idle(const pipeline_trace_t* trace) const;
+//   void dump();
+
 }
\ No newline at end of file
@@ -11,24 +11,72 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <iostream>
+#include <iomanip>
+#include <cmath>
+#include <sstream>
+#include <stdlib.h>
 #include "processor.h"
 #include "processor_impl.h"
+#include "core_variant.h"
+#include "inorder.h"
+#include "scoreboard.h"
 
 using namespace tinyrv;
 
-ProcessorImpl::ProcessorImpl() {
+// instantiated with their pipeline in inorder.cpp and scoreboard.cpp
+extern template class tinyrv::CoreVariant<InorderPipeline, NoPredictor>;
+extern template class tinyrv::CoreVariant<InorderPipeline, GShare>;
+extern template class tinyrv::CoreVariant<Scoreboard<NUM_RSS, ROB_SIZE>, NoPredictor>;
+extern template class tinyrv::CoreVariant<Scoreboard<NUM_RSS, ROB_SIZE>, GShare>;
+extern template class tinyrv::CoreVariant<Scoreboard<0, 0>, NoPredictor>;
+extern template class tinyrv::CoreVariant<Scoreboard<0, 0>, GShare>;
+
+template <typename Pipeline>
+static Core::Ptr create_core(SimPlatform& platform, ProcessorImpl* processor, const ProcessorConfig& config) {
+  if (config.gshare_enabled)
+    return CoreVariant<Pipeline, GShare>::Create(platform, 0, processor, config);
+  return CoreVariant<Pipeline, NoPredictor>::Create(platform, 0, processor, config);
+}
+
+// select the core variant once, the tick loop has no mode checks
+static Core::Ptr create_core(SimPlatform& platform, ProcessorImpl* processor, const ProcessorConfig& config) {
+  if (!config.ooo_enabled)
+    return create_core<InorderPipeline>(platform, processor, config);
+  // fixed-size structures for the default sizes
+  if (config.num_rss == NUM_RSS && config.rob_size == ROB_SIZE)
+    return create_core<Scoreboard<NUM_RSS, ROB_SIZE>>(platform, processor, config);
+  return create_core<Scoreboard<0, 0>>(platform, processor, config);
+}
+
+ProcessorImpl::ProcessorImpl(const ProcessorConfig& config) 
+  : config_(config)
+  , ram_(nullptr)
+  , max_cycles_(0)
+  , sample_period_(0)
+  , sample_unit_(0)
+  , sampled_instrs_(0)
+  , timing_allocs_(0)
+  , alloc_cycle_(0) {
   // initialize simulator
-  SimPlatform::instance().initialize();
+  platform_.initialize();
 
   // create the core
-  core_ = Core::Create(0, this);
+  core_ = create_core(platform_, this, config_);
 
   this->reset();
 }
 
 ProcessorImpl::~ProcessorImpl() {
+  // finalize the trace file with the program exit code
+  if (trace_writer_) {
+    Word exitcode = 0;
+    core_->check_exit(&exitcode, false);
+    trace_writer_->close(exitcode);
+  }
+
   // Terminate simulator
-  SimPlatform::instance().finalize();
+  platform_.finalize();
 }
  
 void ProcessorImpl::reset() {
@@ -37,16 +85,137 @@ void ProcessorImpl::reset() {
 
 void ProcessorImpl::attach_ram(RAM* ram) {
   core_->attach_ram(ram);
+  ram_ = ram;
 }
 
-int ProcessorImpl::run(bool riscv_test) {
-  SimPlatform::instance().reset();
+void ProcessorImpl::prepare() {
+  platform_.make_current();
+  platform_.reset();
   this->reset();
+  // resume from a restored snapshot or a previous fast-forward
+  if (resume_state_) {
+    core_->restore(*resume_state_);
+    resume_state_.reset();
+  }
+}
+
+uint64_t ProcessorImpl::fast_forward(uint64_t instrs) {
+  this->prepare();
+  auto executed = core_->fast_forward(instrs);
+  resume_state_.reset(new Emulator::snapshot_t());
+  core_->snapshot(resume_state_.get());
+  return executed;
+}
+
+int ProcessorImpl::broadcast(const std::vector<TraceChannel*>& channels, bool riscv_test) {
+  this->prepare();
+  core_->broadcast(channels);
+  Word exitcode = 0;
+  if (!core_->check_exit(&exitcode, riscv_test)) {
+    // stopped before the program exited
+    exitcode = -1;
+  }
+  return exitcode;
+}
+
+std::shared_ptr<ProcessorSnapshot> ProcessorImpl::snapshot() {
+  auto snapshot = std::make_shared<ProcessorSnapshot>();
+  ram_->snapshot(&snapshot->ram);
+  if (resume_state_) {
+    snapshot->emulator = *resume_state_;
+  } else {
+    core_->snapshot(&snapshot->emulator);
+  }
+  return snapshot;
+}
+
+void ProcessorImpl::restore(const std::shared_ptr<ProcessorSnapshot>& snapshot) {
+  ram_->restore(snapshot->ram);
+  resume_state_.reset(new Emulator::snapshot_t(snapshot->emulator));
+}
+
+void ProcessorImpl::set_sampling(uint64_t period, uint64_t unit) {
+  sample_period_ = period;
+  sample_unit_ = unit;
+}
+
+void ProcessorImpl::set_max_cycles(uint64_t cycles) {
+  max_cycles_ = cycles;
+}
+
+void ProcessorImpl::record_trace(const char* filename) {
+  trace_writer_.reset(new TraceWriter(filename));
+  core_->attach_trace_writer(trace_writer_.get());
+}
+
+void ProcessorImpl::replay_trace(const char* filename) {
+  trace_reader_.reset(new TraceReader(filename));
+  core_->attach_trace_source(trace_reader_.get());
+}
+
+void ProcessorImpl::attach_trace_source(TraceSource* source) {
+  core_->attach_trace_source(source);
+}
+
+int ProcessorImpl::run(bool riscv_test, uint64_t ff_instrs, uint64_t warmup_instrs) {
+  this->prepare();
   
-  bool done;
+  bool done = false;
   Word exitcode = 0;
+
+  // functional fast-forward, no timing
+  sampled_instrs_ = 0;
+  sample_cpis_.clear();
+  if (ff_instrs != 0) {
+    sampled_instrs_ += core_->fast_forward(ff_instrs);
+  }
+
+  // the program may have exited during a fast-forward,
+  // or before the snapshot it resumes from was taken
+  if (core_->check_exit(&exitcode, riscv_test))
+    return exitcode;
+
+  if (sample_period_ != 0)
+    return this->run_sampled(riscv_test, warmup_instrs);
+
+  // detailed simulation, statistics cover the region after warm-up
+  bool warming_up = (warmup_instrs != 0);
+
+#if EMU_ASYNC
+  if (config_.emu_async) {
+    core_->start_async();
+  }
+#endif
+
+#ifndef NDEBUG
+  // track the timing model's heap allocations, excluding the front-end's,
+  // to verify the steady state is allocation-free
+  uint64_t alloc_base = heap_allocs() - core_->fetch_allocs();
+  timing_allocs_ = 0;
+  alloc_cycle_ = 0;
+#endif
   do {
-    SimPlatform::instance().tick();
+  #ifdef NDEBUG
+    // skip idle cycles (traces need every cycle evaluated)
+    platform_.fast_forward();
+  #endif
+    platform_.tick();
+    if (warming_up && core_->perf_stats().instrs >= warmup_instrs) {
+      core_->reset_stats();
+      warming_up = false;
+    }
+  #ifndef NDEBUG
+    auto allocs = heap_allocs() - core_->fetch_allocs() - alloc_base;
+    if (allocs != timing_allocs_) {
+      timing_allocs_ = allocs;
+      alloc_cycle_ = platform_.cycles();
+    }
+  #endif
+    if (max_cycles_ != 0 && platform_.cycles() >= max_cycles_) {
+      // abandon a run that does not complete
+      exitcode = -1;
+      break;
+    }
     done = true;
     if (core_->running()) {
       Word ec;   
@@ -58,17 +227,164 @@ int ProcessorImpl::run(bool riscv_test) {
     }
   } while (!done);
 
+#if EMU_ASYNC
+  core_->stop_async();
+#endif
+
+  if (warming_up) {
+    // the warm-up never completed, report an empty measured region
+    if (done) {
+      std::cout << "*** warning: program exited during warm-up, no instructions measured." << std::endl;
+    }
+    core_->reset_stats();
+  }
+
   return exitcode;
 }
 
+// SMARTS-style periodic sampling: every sample_period_ instructions,
+// simulate warmup_instrs in detail to warm the pipeline, measure the CPI
+// of the next sample_unit_ instructions, drain the pipeline and
+// fast-forward functionally to the next sampling point.
+int ProcessorImpl::run_sampled(bool riscv_test, uint64_t warmup_instrs) {
+  Word exitcode = 0;
+  for (;;) {
+    // detailed window
+    auto window_start = core_->perf_stats();
+    auto unit_start = window_start;
+    bool measuring = (warmup_instrs == 0);
+    core_->set_fetch_enabled(true);
+    for (;;) {
+    #ifdef NDEBUG
+      platform_.fast_forward();
+    #endif
+      platform_.tick();
+      if (core_->check_exit(&exitcode, riscv_test)) {
+        sampled_instrs_ += core_->perf_stats().instrs - window_start.instrs;
+        return exitcode;
+      }
+      if (max_cycles_ != 0 && platform_.cycles() >= max_cycles_)
+        return -1;
+      auto committed = core_->perf_stats().instrs - window_start.instrs;
+      if (!measuring && committed >= warmup_instrs) {
+        unit_start = core_->perf_stats();
+        measuring = true;
+      }
+      if (measuring && committed >= (warmup_instrs + sample_unit_))
+        break;
+    }
+    auto& unit_end = core_->perf_stats();
+    sample_cpis_.push_back(double(unit_end.cycles - unit_start.cycles) 
+                         / double(unit_end.instrs - unit_start.instrs));
+
+    // drain the pipeline
+    core_->set_fetch_enabled(false);
+    while (core_->running()) {
+    #ifdef NDEBUG
+      platform_.fast_forward();
+    #endif
+      platform_.tick();
+      if (max_cycles_ != 0 && platform_.cycles() >= max_cycles_)
+        return -1;
+    }
+    auto window_instrs = core_->perf_stats().instrs - window_start.instrs;
+    sampled_instrs_ += window_instrs;
+
+    // functional fast-forward to the next sampling point
+    if (sample_period_ > window_instrs) {
+      sampled_instrs_ += core_->fast_forward(sample_period_ - window_instrs);
+      if (core_->check_exit(&exitcode, riscv_test))
+        return exitcode;
+    }
+  }
+}
+
+void ProcessorImpl::perf_stats(uint64_t* instrs, uint64_t* cycles) const {
+  auto stats = core_->region_stats();
+  *instrs = stats.instrs;
+  *cycles = stats.cycles;
+}
+
+void ProcessorImpl::showAllocStats() {
+#ifndef NDEBUG
+  std::cout << std::dec << "ALLOC: timing_allocs=" << timing_allocs_ << ", last_cycle=" << alloc_cycle_
+            << ", cycles=" << platform_.cycles() << std::endl;
+#endif
+}
+
 void ProcessorImpl::showStats() {
-  core_->showStats();
+  if (sample_period_ == 0) {
+    core_->showStats();
+    return;
+  }
+  // mean CPI over the measured units with a 95% confidence interval
+  uint64_t n = sample_cpis_.size();
+  if (n == 0) {
+    std::cout << "*** warning: program exited before a sampling unit completed, no CPI measured." << std::endl;
+  }
+  double mean = 0, var = 0;
+  for (auto cpi : sample_cpis_) {
+    mean += cpi;
+  }
+  mean = n ? (mean / n) : 0;
+  for (auto cpi : sample_cpis_) {
+    var += (cpi - mean) * (cpi - mean);
+  }
+  var = (n > 1) ? (var / (n - 1)) : 0;
+  double ci = 1.96 * std::sqrt(var / (n ? n : 1));
+  std::cout << std::dec << "PERF: instrs=" << sampled_instrs_ << ", samples=" << n
+            << std::fixed << std::setprecision(4) << ", cpi=" << mean << " +/- " << ci
+            << " (95% confidence)" << std::defaultfloat << std::endl;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool ProcessorConfig::parse(const std::string& spec) {
+  *this = ProcessorConfig();
+  std::stringstream ss(spec);
+  std::string token;
+  std::getline(ss, token, ':');
+  if (token != "base") {
+    if (token.empty())
+      return false;
+    for (auto c : token) {
+      switch (c) {
+      case 'o': ooo_enabled = true; break;
+      case 'g': gshare_enabled = true; break;
+      default: return false;
+      }
+    }
+  }
+  while (std::getline(ss, token, ':')) {
+    auto pos = token.find('=');
+    if (pos == std::string::npos)
+      return false;
+    auto key = token.substr(0, pos);
+    char* end;
+    auto value = std::strtoul(token.c_str() + pos + 1, &end, 0);
+    if (*end != '\0' || value == 0)
+      return false;
+    if (key == "rob") {
+      rob_size = value;
+    } else if (key == "rs") {
+      num_rss = value;
+    } else if (key == "alu") {
+      alu_latency = value;
+    } else if (key == "lsu") {
+      lsu_latency = value;
+    } else if (key == "csr") {
+      csr_latency = value;
+    } else {
+      return false;
+    }
+  }
+  return true;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 
-Processor::Processor() 
-  : impl_(new ProcessorImpl())
+Processor::Processor(const ProcessorConfig& config) 
+  : impl_(new ProcessorImpl(config))
 {}
 
 Processor::~Processor() {
@@ -79,10 +395,54 @@ void Processor::attach_ram(RAM* mem) {
   impl_->attach_ram(mem);
 }
 
-int Processor::run(bool riscv_test) {
-  return impl_->run(riscv_test);
+void Processor::set_sampling(uint64_t period, uint64_t unit) {
+  impl_->set_sampling(period, unit);
+}
+
+void Processor::set_max_cycles(uint64_t cycles) {
+  impl_->set_max_cycles(cycles);
+}
+
+void Processor::record_trace(const char* filename) {
+  impl_->record_trace(filename);
+}
+
+void Processor::replay_trace(const char* filename) {
+  impl_->replay_trace(filename);
+}
+
+void Processor::attach_trace_source(TraceSource* source) {
+  impl_->attach_trace_source(source);
+}
+
+int Processor::run(bool riscv_test, uint64_t ff_instrs, uint64_t warmup_instrs) {
+  return impl_->run(riscv_test, ff_instrs, warmup_instrs);
+}
+
+uint64_t Processor::fast_forward(uint64_t instrs) {
+  return impl_->fast_forward(instrs);
+}
+
+int Processor::broadcast(const std::vector<TraceChannel*>& channels, bool riscv_test) {
+  return impl_->broadcast(channels, riscv_test);
+}
+
+std::shared_ptr<ProcessorSnapshot> Processor::snapshot() {
+  return impl_->snapshot();
+}
+
+void Processor::restore(const std::shared_ptr<ProcessorSnapshot>& snapshot) {
+  impl_->restore(snapshot);
+}
+
+void Processor::perf_stats(uint64_t* instrs, uint64_t* cycles) const {
+  impl_->perf_stats(instrs, cycles);
 }
 
 void Processor::showStats() {
   impl_->showStats();
+}
+
+void Processor::showAllocStats() {
+  impl_->showAllocStats();
 }
\ No newline at end of file
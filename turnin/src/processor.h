@@ -14,23 +14,80 @@
 #pragma once
 
 #include <stdint.h>
+#include <memory>
+#include <string>
+#include <vector>
+#include "config.h"
 
 namespace tinyrv {
 
 class RAM;
 class ProcessorImpl;
+class TraceSource;
+class TraceChannel;
+struct ProcessorSnapshot;
+
+// per-simulation configuration
+struct ProcessorConfig {
+  bool ooo_enabled;     // out-of-order pipeline
+  bool gshare_enabled;  // gshare branch predictor
+  bool emu_async;       // run the emulator on its own host thread (-A)
+  uint32_t rob_size;
+  uint32_t num_rss;
+  uint32_t alu_latency;
+  uint32_t lsu_latency;
+  uint32_t csr_latency;
+
+  ProcessorConfig()
+    : ooo_enabled(false)
+    , gshare_enabled(false)
+    , emu_async(false)
+    , rob_size(ROB_SIZE)
+    , num_rss(NUM_RSS)
+    , alu_latency(ALU_LATENCY)
+    , lsu_latency(LSU_LATENCY)
+    , csr_latency(CSR_LATENCY)
+  {}
+
+  // parse "<mode>[:<key>=<value>]...", where mode is base, o, g or og
+  // and the keys are rob, rs, alu, lsu and csr
+  bool parse(const std::string& spec);
+};
 
 class Processor {
 public:
-  Processor();
+  Processor(const ProcessorConfig& config = ProcessorConfig());
   ~Processor();
 
   void attach_ram(RAM* mem);
 
-  int run(bool riscv_test);
+  void set_sampling(uint64_t period, uint64_t unit);
+
+  void set_max_cycles(uint64_t cycles);
+
+  void record_trace(const char* filename);
+
+  void replay_trace(const char* filename);
+
+  void attach_trace_source(TraceSource* source);
+
+  int run(bool riscv_test, uint64_t ff_instrs = 0, uint64_t warmup_instrs = 0);
+
+  uint64_t fast_forward(uint64_t instrs);
+
+  int broadcast(const std::vector<TraceChannel*>& channels, bool riscv_test);
+
+  std::shared_ptr<ProcessorSnapshot> snapshot();
+
+  void restore(const std::shared_ptr<ProcessorSnapshot>& snapshot);
+
+  void perf_stats(uint64_t* instrs, uint64_t* cycles) const;
 
   void showStats();
 
+  // timing model heap allocations of the last run, debug builds only
+  void showAllocStats();
+
 private:
   ProcessorImpl* impl_;
 };
@@ -13,27 +13,88 @@
 
 #pragma once
 
+#include <vector>
+#include <memory>
+#include "processor.h"
 #include "core.h"
+#include "tracefile.h"
 
 namespace tinyrv {
 
+// memory and architectural state, the memory pages are shared
+// copy-on-write so taking and restoring a snapshot is cheap
+struct ProcessorSnapshot {
+  RAM::snapshot_t ram;
+  Emulator::snapshot_t emulator;
+};
+
 class ProcessorImpl {
 public:
 
-  ProcessorImpl();
+  ProcessorImpl(const ProcessorConfig& config);
   ~ProcessorImpl();
 
   void attach_ram(RAM* mem);
 
-  int run(bool riscv_test);
+  void set_sampling(uint64_t period, uint64_t unit);
+
+  void set_max_cycles(uint64_t cycles);
+
+  void record_trace(const char* filename);
+
+  void replay_trace(const char* filename);
+
+  void attach_trace_source(TraceSource* source);
+
+  int run(bool riscv_test, uint64_t ff_instrs = 0, uint64_t warmup_instrs = 0);
+
+  uint64_t fast_forward(uint64_t instrs);
+
+  int broadcast(const std::vector<TraceChannel*>& channels, bool riscv_test);
+
+  std::shared_ptr<ProcessorSnapshot> snapshot();
+
+  void restore(const std::shared_ptr<ProcessorSnapshot>& snapshot);
+
+  void perf_stats(uint64_t* instrs, uint64_t* cycles) const;
 
   void showStats();
 
+  // timing model heap allocations of the last run, debug builds only
+  void showAllocStats();
+
 private:
  
   void reset();
 
+  void prepare();
+
+  int run_sampled(bool riscv_test, uint64_t warmup_instrs);
+
+  ProcessorConfig config_;
+  SimPlatform platform_;
   Core::Ptr core_;
+  RAM* ram_;
+
+  // detailed simulation limit, zero for none
+  uint64_t max_cycles_;
+
+  // architectural state the next run resumes from
+  std::unique_ptr<Emulator::snapshot_t> resume_state_;
+
+  // periodic sampling configuration and results
+  uint64_t sample_period_;
+  uint64_t sample_unit_;
+  uint64_t sampled_instrs_;
+  std::vector<double> sample_cpis_;
+
+  // timing model heap allocations and the cycle of the last one
+  uint64_t timing_allocs_;
+  uint64_t alloc_cycle_;
+
+  // instruction trace recording and replay
+  std::unique_ptr<TraceWriter> trace_writer_;
+  std::unique_ptr<TraceReader> trace_reader_;
 };
 
 }
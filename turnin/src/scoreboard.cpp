@@ -1,28 +1,39 @@
 #include <iostream>
+#include <algorithm>
 #include <assert.h>
 #include <util.h>
 #include "types.h"
 #include "scoreboard.h"
 #include "core.h"
+#include "core_variant.h"
 #include "debug.h"
 
 
 using namespace tinyrv;
 
-Scoreboard::Scoreboard(Core* core, uint32_t num_RSs, uint32_t rob_size) 
+template <uint32_t NumRSs, uint32_t RobSize>
+Scoreboard<NumRSs, RobSize>::Scoreboard(Core* core, const ProcessorConfig& config) 
   : core_(core)  
-  , RAT_(NUM_REGS)
-  , RS_(num_RSs)
-  , RST_(rob_size, -1) {
+  , RS_(config.num_rss)
+  , RST_(config.rob_size, -1) {
   // create the ROB
-  ROB_ = ReorderBuffer::Create(this, ROB_SIZE);
+  ROB_ = ReorderBuffer<RobSize>::Create(core->platform(), &RAT_, config.rob_size);
 }
 
-Scoreboard::~Scoreboard() {
+template <uint32_t NumRSs, uint32_t RobSize>
+Scoreboard<NumRSs, RobSize>::~Scoreboard() {
   //--
 }
 
-bool Scoreboard::issue(pipeline_trace_t* trace) {
+template <uint32_t NumRSs, uint32_t RobSize>
+void Scoreboard<NumRSs, RobSize>::reset() {
+  RAT_.clear();
+  RS_.clear();
+  RST_.fill(-1);
+}
+
+template <uint32_t NumRSs, uint32_t RobSize>
+bool Scoreboard<NumRSs, RobSize>::issue(pipeline_trace_t* trace) {
   auto& ROB = ROB_;
   auto& RAT = RAT_;
   
@@ -55,30 +66,24 @@ bool Scoreboard::issue(pipeline_trace_t* trace) {
 
   return true;
 }
-std::vector<pipeline_trace_t*> Scoreboard::execute() {
-  std::vector<pipeline_trace_t*> traces;
+template <uint32_t NumRSs, uint32_t RobSize>
+void Scoreboard<NumRSs, RobSize>::execute(TraceBuffer* traces) {
   auto& FUs = core_->FUs_;
 
-  // search the RS for any valid and not yet running entry
+  // select each valid and not yet running entry
   // that is ready (i.e. both rs1_index and rs2_index are -1)
   // send it to its corresponding FUs
   // mark it as running
-  // add its trace to return list
-  for (int i = 0; i < (int)RS_.size(); ++i) { 
+  // add its trace to the output buffer
+  for (int i = RS_.find_ready(0); i != -1; i = RS_.find_ready(i + 1)) { 
     auto& rs_entry = RS_[i];
-    if (!rs_entry.valid || rs_entry.running)
-      continue;
-
-    if (rs_entry.rs1_index == -1 && rs_entry.rs2_index == -1) {
-      rs_entry.running = true;
-      traces.push_back(rs_entry.trace);
-    }
+    RS_.set_running(i);
+    traces->push(rs_entry.trace);
   }
-
-  return traces;
 }
 
-pipeline_trace_t* Scoreboard::writeback() {
+template <uint32_t NumRSs, uint32_t RobSize>
+pipeline_trace_t* Scoreboard<NumRSs, RobSize>::writeback() {
   pipeline_trace_t* trace = nullptr;
   auto& ROB = ROB_;
   auto& FUs = core_->FUs_;
@@ -92,18 +97,7 @@ pipeline_trace_t* Scoreboard::writeback() {
 
     // broadcast result to all RS pending for this FU's rs_index
     // invalidate matching rs_index by setting it to -1 to imply that the operand value is now available
-    for (uint32_t i = 0; i < RS_.size(); ++i) { 
-      auto& rs_entry = RS_[i];
-      if (!rs_entry.valid)
-        continue;
-
-      if (rs_entry.rs1_index == fu_entry.rs_index) {
-        rs_entry.rs1_index = -1;
-      }
-      if (rs_entry.rs2_index == fu_entry.rs_index) {
-        rs_entry.rs2_index = -1;
-      }
-    }
+    RS_.wakeup(fu_entry.rs_index);
     
     // clear RST by invalidating current ROB entry to -1
     RST_[fu_entry.rob_index] = -1;
@@ -128,7 +122,8 @@ pipeline_trace_t* Scoreboard::writeback() {
 }
 
 
-pipeline_trace_t* Scoreboard::commit() {
+template <uint32_t NumRSs, uint32_t RobSize>
+pipeline_trace_t* Scoreboard<NumRSs, RobSize>::commit() {
   pipeline_trace_t* trace = nullptr;
   if (!ROB_->Committed.empty()) {
     trace = ROB_->Committed.front();
@@ -137,7 +132,30 @@ pipeline_trace_t* Scoreboard::commit() {
   return trace;
 }
 
-void Scoreboard::dump() {
+template <uint32_t NumRSs, uint32_t RobSize>
+bool Scoreboard<NumRSs, RobSize>::idle(const pipeline_trace_t* /*trace*/) const {
+  if (!RS_.is_full() || !ROB_->Committed.empty())
+    return false;
+  for (auto& fu : core_->FUs_) {
+    if (!fu->Output.empty())
+      return false;
+  }
+  return !RS_.has_ready();
+}
+
+template <uint32_t NumRSs, uint32_t RobSize>
+void Scoreboard<NumRSs, RobSize>::dump() {
   RS_.dump();
   ROB_->dump();
 }
+
+///////////////////////////////////////////////////////////////////////////////
+
+// the core variants are instantiated with their pipeline for inlining,
+// the fixed sizes cover the default configuration
+template class tinyrv::Scoreboard<NUM_RSS, ROB_SIZE>;
+template class tinyrv::Scoreboard<0, 0>;
+template class tinyrv::CoreVariant<Scoreboard<NUM_RSS, ROB_SIZE>, NoPredictor>;
+template class tinyrv::CoreVariant<Scoreboard<NUM_RSS, ROB_SIZE>, GShare>;
+template class tinyrv::CoreVariant<Scoreboard<0, 0>, NoPredictor>;
+template class tinyrv::CoreVariant<Scoreboard<0, 0>, GShare>;
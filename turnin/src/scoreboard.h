@@ -22,37 +22,47 @@ namespace tinyrv {
 
 class Core;
 struct pipeline_trace_t;
+struct ProcessorConfig;
 
 // register status table 
 // track the mapping from ROB index and RS index
-typedef std::vector<int> RegisterStatusTable;
+template <uint32_t Size>
+using RegisterStatusTable = SizedArray<int, Size>;
 
-class Scoreboard : public Pipeline {
+// NumRSs = RobSize = 0 selects the structure sizes from the config
+template <uint32_t NumRSs, uint32_t RobSize>
+class Scoreboard {
 public:
-  Scoreboard(Core* core, uint32_t num_RSs, uint32_t rob_size);
+  Scoreboard(Core* core, const ProcessorConfig& config);
 
   ~Scoreboard();
 
-  bool issue(pipeline_trace_t* trace) override;
+  uint32_t execute_width() const {
+    return RS_.size();
+  }
 
-  std::vector<pipeline_trace_t*> execute() override;
+  void reset();
 
-  pipeline_trace_t* writeback() override;
+  bool issue(pipeline_trace_t* trace);
 
-  pipeline_trace_t* commit() override;
+  void execute(TraceBuffer* traces);
 
-  void dump() override;
+  pipeline_trace_t* writeback();
+
+  pipeline_trace_t* commit();
+
+  bool idle(const pipeline_trace_t* trace) const;
+
+  void dump();
 
 private:
 
   Core* core_;
   
   RegisterAliasTable RAT_;  
-  ReservationStation RS_;
-  RegisterStatusTable RST_;  
-  ReorderBuffer::Ptr ROB_;
-  
-  friend class ReorderBuffer;
+  ReservationStation<NumRSs> RS_;
+  RegisterStatusTable<RobSize> RST_;  
+  typename ReorderBuffer<RobSize>::Ptr ROB_;
 };
 
 }
\ No newline at end of file
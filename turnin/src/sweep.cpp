@@ -0,0 +1,217 @@
+// Copyright 2024 Blaise Tine
+//
+// Licensed under the Apache License;
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Configuration sweep driver.
+// Runs every (program x config) pair on a pool of host threads inside one
+// process and prints one CSV row per run, in matrix order. Each run owns its
+// platform and memory. The programs are loaded, and optionally fast-forwarded,
+// once; every run restores the program's snapshot, sharing its memory
+// copy-on-write.
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <sstream>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <stdlib.h>
+#include <unistd.h>
+#include <util.h>
+#include "processor.h"
+#include "mem.h"
+#include "config.h"
+
+using namespace tinyrv;
+
+static void show_usage() {
+   std::cout << "Usage: [-j <n>: threads] [-c <configs>: comma-separated list of <mode>[:<key>=<value>]...] [-x <n>: max cycles per run, 0: none (default: " << MAX_CYCLES << ")] [-F <n>: fast-forward n instrs] [-h: help] <programs...>" << std::endl;
+}
+
+struct sweep_config_t {
+  std::string name;
+  ProcessorConfig config;
+};
+
+struct sweep_run_t {
+  uint32_t program;
+  uint32_t config;
+  int      exitcode;
+  uint64_t instrs;
+  uint64_t cycles;
+  double   seconds;
+};
+
+uint32_t num_threads = 0;
+uint64_t max_cycles = MAX_CYCLES;
+uint64_t ff_instrs = 0;
+std::vector<sweep_config_t> configs;
+std::vector<const char*> programs;
+
+static bool parse_config(const std::string& name, sweep_config_t* out) {
+  out->name = name;
+  if (!out->config.parse(name))
+    return false;
+  // the pool already keeps the host cores busy
+  out->config.emu_async = false;
+  return true;
+}
+
+static void parse_args(int argc, char **argv) {
+  const char* config_list = "base,g";
+  int c;
+  while ((c = getopt(argc, argv, "j:c:x:F:h?")) != -1) {
+    switch (c) {
+    case 'j':
+      num_threads = std::strtoul(optarg, nullptr, 0);
+      break;
+    case 'c':
+      config_list = optarg;
+      break;
+    case 'x':
+      max_cycles = std::strtoull(optarg, nullptr, 0);
+      break;
+    case 'F':
+      ff_instrs = std::strtoull(optarg, nullptr, 0);
+      break;
+    case 'h':
+    case '?':
+      show_usage();
+      exit(0);
+      break;
+    default:
+      show_usage();
+      exit(-1);
+    }
+  }
+
+  std::stringstream ss(config_list);
+  std::string name;
+  while (std::getline(ss, name, ',')) {
+    sweep_config_t config;
+    if (!parse_config(name, &config)) {
+      std::cout << "*** error: invalid config '" << name << "'." << std::endl;
+      exit(-1);
+    }
+    configs.push_back(config);
+  }
+
+  for (int i = optind; i < argc; ++i) {
+    programs.push_back(argv[i]);
+  }
+  if (programs.empty() || configs.empty()) {
+    show_usage();
+    exit(-1);
+  }
+
+  if (num_threads == 0) {
+    num_threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+}
+
+// load the program and fast-forward it to the start of the runs
+static void load_program(const char* program, std::shared_ptr<ProcessorSnapshot>* snapshot) {
+  RAM ram(RAM_PAGE_SIZE);
+  std::string program_ext(fileExtension(program));
+  if (program_ext == "bin") {
+    ram.loadBinImage(program, STARTUP_ADDR);
+  } else if (program_ext == "hex") {
+    ram.loadHexImage(program);
+  } else {
+    std::cout << "*** error: only *.bin or *.hex images supported: " << program << std::endl;
+    exit(-1);
+  }
+  Processor processor;
+  processor.attach_ram(&ram);
+  if (ff_instrs != 0) {
+    processor.fast_forward(ff_instrs);
+  }
+  *snapshot = processor.snapshot();
+}
+
+static void run_one(const std::shared_ptr<ProcessorSnapshot>& snapshot, const ProcessorConfig& config, sweep_run_t* run) {
+  auto start = std::chrono::steady_clock::now();
+
+  RAM ram(RAM_PAGE_SIZE);
+  Processor processor(config);
+  processor.attach_ram(&ram);
+  processor.restore(snapshot);
+  processor.set_max_cycles(max_cycles);
+  run->exitcode = processor.run(true);
+  processor.perf_stats(&run->instrs, &run->cycles);
+
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  run->seconds = elapsed.count();
+}
+
+int main(int argc, char **argv) {
+  parse_args(argc, argv);
+
+  auto start = std::chrono::steady_clock::now();
+
+  // load each program once
+  std::vector<std::shared_ptr<ProcessorSnapshot>> snapshots(programs.size());
+  for (uint32_t i = 0; i < programs.size(); ++i) {
+    load_program(programs[i], &snapshots[i]);
+  }
+
+  // build the run matrix
+  std::vector<sweep_run_t> runs;
+  for (uint32_t p = 0; p < programs.size(); ++p) {
+    for (uint32_t c = 0; c < configs.size(); ++c) {
+      runs.push_back({p, c, -1, 0, 0, 0});
+    }
+  }
+
+  // the workers pull runs from a shared index
+  std::atomic<uint32_t> next(0);
+  auto worker = [&]() {
+    for (;;) {
+      uint32_t index = next++;
+      if (index >= runs.size())
+        break;
+      auto& run = runs[index];
+      run_one(snapshots[run.program], configs[run.config].config, &run);
+    }
+  };
+  num_threads = std::min<uint32_t>(num_threads, runs.size());
+  std::vector<std::thread> threads;
+  for (uint32_t i = 1; i < num_threads; ++i) {
+    threads.emplace_back(worker);
+  }
+  worker();
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+  int failures = 0;
+  std::cout << "program,config,status,instrs,cycles,seconds" << std::endl;
+  for (auto& run : runs) {
+    const char* status = "passed";
+    if (run.exitcode != 0) {
+      bool timeout = (max_cycles != 0 && run.cycles >= max_cycles);
+      status = timeout ? "timeout" : "failed";
+      ++failures;
+    }
+    std::cout << programs[run.program] << "," << configs[run.config].name << ","
+              << status << "," << run.instrs << "," << run.cycles << ","
+              << std::fixed << std::setprecision(6) << run.seconds << std::defaultfloat << std::endl;
+  }
+  std::cout << "SWEEP: runs=" << runs.size() << ", failed=" << failures << ", threads=" << num_threads
+            << ", seconds=" << std::fixed << std::setprecision(6) << elapsed.count() << std::defaultfloat << std::endl;
+
+  return failures ? 1 : 0;
+}
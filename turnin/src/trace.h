@@ -13,26 +13,19 @@
 
 #pragma once
 
-#include <memory>
+#include <new>
+#include <vector>
+#include <mutex>
+#include <unordered_set>
 #include <iostream>
+#include <type_traits>
 #include <util.h>
+#include <spsc_queue.h>
 #include "types.h"
 #include "debug.h"
 
 namespace tinyrv {
 
-class ITraceData {
-public:
-    using Ptr = std::shared_ptr<ITraceData>;
-    ITraceData() {}
-    virtual ~ITraceData() {}
-};
-
-struct LsuTraceData : public ITraceData {
-  using Ptr = std::shared_ptr<LsuTraceData>;
-  mem_addr_size_t mem_addrs;
-};
-
 struct pipeline_trace_t {
 public:
   // instruction idertifier
@@ -42,13 +35,13 @@ public:
   Word        PC; 
 
   // destination register
-  uint32_t    rd;   
+  uint8_t     rd;   
 
   // first source register
-  uint32_t    rs1;
+  uint8_t     rs1;
   
   // second source register
-  uint32_t    rs2;
+  uint8_t     rs2;
 
   // writeback enable
   bool        wb; 
@@ -64,8 +57,8 @@ public:
     uint32_t fu_op;
   };
 
-  // additional trace data
-  ITraceData::Ptr data;
+  // memory access (size is 0 if none)
+  mem_addr_size_t mem_addrs;
 
   pipeline_trace_t(uint64_t uuid, Word PC) 
     : uuid(uuid)
@@ -76,7 +69,7 @@ public:
     , wb(false)
     , fu_type(FUType::ALU)
     , fu_op(0)
-    , data(nullptr)
+    , mem_addrs({0, 0})
   {}
 
   pipeline_trace_t(const pipeline_trace_t& rhs) 
@@ -88,17 +81,84 @@ public:
     , wb(rhs.wb)
     , fu_type(rhs.fu_type)
     , fu_op(rhs.fu_op)
-    , data(rhs.data)
+    , mem_addrs(rhs.mem_addrs)
   {}
   
   ~pipeline_trace_t() {}
 };
 
+// Recycling arena of instruction traces sized to the in-flight window.
+// Traces are allocated by the emulator, possibly on its own thread, and
+// released at commit; a lock-free free list carries them back.
+// Should the arena run dry, traces fall back to the heap.
+class TracePool {
+public:
+  TracePool(uint32_t capacity)
+    : store_(capacity)
+    , free_(capacity) {
+    this->reset();
+  }
+
+  ~TracePool() {
+    for (auto trace : heap_traces_) {
+      ::operator delete(trace);
+    }
+  }
+
+  // reclaim every trace, including those still in flight in a
+  // timing model being reset; the emulator thread must be stopped
+  void reset() {
+    free_.clear();
+    for (auto& slot : store_) {
+      free_.try_push(reinterpret_cast<pipeline_trace_t*>(&slot));
+    }
+    for (auto trace : heap_traces_) {
+      ::operator delete(trace);
+    }
+    heap_traces_.clear();
+  }
+
+  pipeline_trace_t* allocate(uint64_t uuid, Word PC) {
+    pipeline_trace_t* ptr;
+    void* mem;
+    if (free_.try_pop(&ptr)) {
+      mem = ptr;
+    } else {
+      mem = ::operator new(sizeof(pipeline_trace_t));
+      std::lock_guard<std::mutex> lock(heap_mutex_);
+      heap_traces_.insert(mem);
+    }
+    return new (mem) pipeline_trace_t(uuid, PC);
+  }
+
+  void release(pipeline_trace_t* trace) {
+    trace->~pipeline_trace_t();
+    auto slot = reinterpret_cast<slot_t*>(trace);
+    if (slot >= store_.data() && slot < (store_.data() + store_.size())) {
+      free_.try_push(trace);
+    } else {
+      {
+        std::lock_guard<std::mutex> lock(heap_mutex_);
+        heap_traces_.erase(trace);
+      }
+      ::operator delete(trace);
+    }
+  }
+
+private:
+  typedef std::aligned_storage<sizeof(pipeline_trace_t), alignof(pipeline_trace_t)>::type slot_t;
+  std::vector<slot_t> store_;
+  SPSCQueue<pipeline_trace_t*> free_;
+  // heap fallback traces, tracked so a reset can reclaim them
+  std::unordered_set<void*> heap_traces_;
+  std::mutex heap_mutex_;
+};
+
 inline std::ostream &operator<<(std::ostream &os, const pipeline_trace_t& state) {
   os << "PC=0x" << std::hex << state.PC;
   os << ", wb=" << state.wb;
   if (state.wb) {
-     os << ", rd=x" << std::dec << state.rd;
+     os << ", rd=x" << std::dec << uint32_t(state.rd);
   }
   os << ", ex=" << state.fu_type;
   os << " (#" << std::dec << state.uuid << ")";
@@ -0,0 +1,86 @@
+// Copyright 2024 Blaise Tine
+//
+// Licensed under the Apache License;
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <backoff.h>
+#include "tracechannel.h"
+#include "trace.h"
+
+using namespace tinyrv;
+
+TraceChannel::TraceChannel(uint32_t capacity)
+  : queue_(capacity)
+  , exitcode_(0)
+  , done_(false)
+  , detached_(false)
+{}
+
+TraceChannel::~TraceChannel() {
+  //--
+}
+
+void TraceChannel::send(const record_t& record) {
+  Backoff backoff;
+  while (!queue_.try_push(record)) {
+    if (this->detached())
+      return;
+    backoff.wait();
+  }
+}
+
+void TraceChannel::push(const pipeline_trace_t& trace) {
+  this->send({trace.uuid, trace.PC, trace.fu_op, trace.mem_addrs, trace.rd, trace.rs1, trace.rs2,
+              uint8_t(trace.fu_type), trace.wb, false, false, 0});
+}
+
+void TraceChannel::push_last(const pipeline_trace_t& trace, Word exitcode) {
+  this->send({trace.uuid, trace.PC, trace.fu_op, trace.mem_addrs, trace.rd, trace.rs1, trace.rs2,
+              uint8_t(trace.fu_type), trace.wb, true, false, exitcode});
+}
+
+void TraceChannel::close(Word exitcode) {
+  this->send({0, 0, 0, {0, 0}, 0, 0, 0, 0, false, true, true, exitcode});
+}
+
+pipeline_trace_t* TraceChannel::next(TracePool& pool) {
+  if (done_)
+    return nullptr;
+
+  record_t rec;
+  Backoff backoff;
+  while (!queue_.try_pop(&rec)) {
+    backoff.wait();
+  }
+  if (rec.last) {
+    exitcode_ = rec.exitcode;
+    done_ = true;
+  }
+  if (rec.empty)
+    return nullptr;
+
+  auto trace = pool.allocate(rec.uuid, rec.PC);
+  trace->wb        = rec.wb;
+  trace->fu_type   = FUType(rec.fu_type);
+  trace->fu_op     = rec.fu_op;
+  trace->rd        = rec.rd;
+  trace->rs1       = rec.rs1;
+  trace->rs2       = rec.rs2;
+  trace->mem_addrs = rec.mem_addrs;
+  return trace;
+}
+
+bool TraceChannel::check_exit(Word* exitcode, bool riscv_test) const {
+  if (!done_)
+    return false;
+  *exitcode = riscv_test ? (1 - exitcode_) : exitcode_;
+  return true;
+}
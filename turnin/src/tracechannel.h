@@ -0,0 +1,86 @@
+// Copyright 2024 Blaise Tine
+//
+// Licensed under the Apache License;
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <atomic>
+#include <spsc_queue.h>
+#include "types.h"
+#include "tracefile.h"
+
+namespace tinyrv {
+
+// Bounded instruction stream from an emulator thread to a timing model
+// on another thread. The producer blocks while the channel is full and the
+// consumer while it is empty, so the timing model never sees a gap.
+// The last instruction carries the exit code in-band, so the consumer
+// reports the exit on the same cycle as a live run would.
+// A consumer that gives up detaches, and the producer then drops its
+// records instead of waiting for room.
+class TraceChannel : public TraceSource {
+public:
+  TraceChannel(uint32_t capacity);
+  ~TraceChannel();
+
+  // producer side
+  void push(const pipeline_trace_t& trace);
+
+  void push_last(const pipeline_trace_t& trace, Word exitcode);
+
+  // end a stream that has no instructions left to send
+  void close(Word exitcode);
+
+  // consumer side
+  pipeline_trace_t* next(TracePool& pool) override;
+
+  bool done() const {
+    return done_;
+  }
+
+  bool check_exit(Word* exitcode, bool riscv_test) const override;
+
+  // stop consuming, the remaining records are discarded
+  void detach() {
+    detached_.store(true, std::memory_order_release);
+  }
+
+  bool detached() const {
+    return detached_.load(std::memory_order_acquire);
+  }
+
+private:
+
+  struct record_t {
+    uint64_t uuid;
+    Word     PC;
+    uint32_t fu_op;
+    mem_addr_size_t mem_addrs;
+    uint8_t  rd;
+    uint8_t  rs1;
+    uint8_t  rs2;
+    uint8_t  fu_type;
+    bool     wb;
+    bool     last;
+    bool     empty;
+    Word     exitcode;
+  };
+
+  void send(const record_t& record);
+
+  SPSCQueue<record_t> queue_;
+  Word exitcode_;
+  bool done_;
+  std::atomic<bool> detached_;
+};
+
+}
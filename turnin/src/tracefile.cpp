@@ -0,0 +1,241 @@
+// Copyright 2024 Blaise Tine
+//
+// Licensed under the Apache License;
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <iostream>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "tracefile.h"
+#include "trace.h"
+
+using namespace tinyrv;
+
+#define TRACE_FILE_MAGIC   0x54565254 // "TRVT"
+#define TRACE_FILE_VERSION 1
+
+enum {
+  TRACE_FLAG_WB      = 1 << 0,
+  TRACE_SHIFT_FUTYPE = 1,
+  TRACE_SHIFT_FUOP   = 3,
+  TRACE_FLAG_PCJUMP  = 1 << 6,
+  TRACE_FLAG_MEM     = 1 << 7,
+};
+
+static uint8_t* put_varint(uint8_t* p, int64_t value) {
+  uint64_t zz = (uint64_t(value) << 1) ^ uint64_t(value >> 63);
+  while (zz >= 0x80) {
+    *p++ = uint8_t(zz) | 0x80;
+    zz >>= 7;
+  }
+  *p++ = uint8_t(zz);
+  return p;
+}
+
+// returns nullptr if the varint overruns the buffer or 64 bits
+static const uint8_t* get_varint(const uint8_t* p, const uint8_t* end, int64_t* value) {
+  uint64_t zz = 0;
+  uint32_t shift = 0;
+  uint8_t byte;
+  do {
+    if (p == end || shift >= 64)
+      return nullptr;
+    byte = *p++;
+    zz |= uint64_t(byte & 0x7f) << shift;
+    shift += 7;
+  } while (byte & 0x80);
+  *value = int64_t(zz >> 1) ^ -int64_t(zz & 0x1);
+  return p;
+}
+
+static void corrupt_trace() {
+  std::cout << "*** error: corrupt trace file." << std::endl;
+  exit(-1);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+TraceWriter::TraceWriter(const char* filename)
+  : ofs_(filename, std::ios::binary)
+  , count_(0)
+  , last_PC_(STARTUP_ADDR - 4)
+  , last_addr_(0) {
+  if (!ofs_) {
+    std::cout << "*** error: cannot create trace file " << filename << "." << std::endl;
+    exit(-1);
+  }
+  // reserve the header, written on close
+  trace_file_header_t header{};
+  ofs_.write((const char*)&header, sizeof(header));
+}
+
+TraceWriter::~TraceWriter() {
+  //--
+}
+
+void TraceWriter::write(const pipeline_trace_t& trace) {
+  uint8_t buf[32];
+  uint8_t* p = buf;
+
+  bool has_mem = (trace.fu_type == FUType::LSU && trace.mem_addrs.size != 0);
+
+  uint8_t flags = (trace.wb ? TRACE_FLAG_WB : 0)
+                | (uint8_t(trace.fu_type) << TRACE_SHIFT_FUTYPE)
+                | (uint8_t(trace.fu_op) << TRACE_SHIFT_FUOP)
+                | ((trace.PC != last_PC_ + 4) ? TRACE_FLAG_PCJUMP : 0)
+                | (has_mem ? TRACE_FLAG_MEM : 0);
+  *p++ = flags;
+
+  uint16_t regs = trace.rd | (trace.rs1 << 5) | (trace.rs2 << 10);
+  *p++ = regs & 0xff;
+  *p++ = regs >> 8;
+
+  if (flags & TRACE_FLAG_PCJUMP) {
+    p = put_varint(p, int64_t(trace.PC) - int64_t(last_PC_ + 4));
+  }
+  last_PC_ = trace.PC;
+
+  if (has_mem) {
+    auto& mem = trace.mem_addrs;
+    p = put_varint(p, int64_t(mem.addr - last_addr_));
+    *p++ = mem.size;
+    last_addr_ = mem.addr;
+  }
+
+  ofs_.write((const char*)buf, p - buf);
+  ++count_;
+}
+
+void TraceWriter::close(Word exitcode) {
+  trace_file_header_t header{TRACE_FILE_MAGIC, TRACE_FILE_VERSION, count_, exitcode, 0};
+  ofs_.seekp(0);
+  ofs_.write((const char*)&header, sizeof(header));
+  ofs_.close();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+TraceReader::TraceReader(const char* filename)
+  : data_(nullptr)
+  , size_(0)
+  , cur_(nullptr)
+  , end_(nullptr)
+  , remaining_(0)
+  , exitcode_(0)
+  , last_PC_(STARTUP_ADDR - 4)
+  , last_addr_(0)
+  , fetch_seq_(0) {
+  int fd = open(filename, O_RDONLY);
+  struct stat st;
+  if (fd < 0 || fstat(fd, &st) != 0 || size_t(st.st_size) < sizeof(trace_file_header_t)) {
+    std::cout << "*** error: cannot read trace file " << filename << "." << std::endl;
+    exit(-1);
+  }
+  size_ = st.st_size;
+  data_ = (uint8_t*)mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (data_ == MAP_FAILED) {
+    std::cout << "*** error: cannot map trace file " << filename << "." << std::endl;
+    exit(-1);
+  }
+
+  auto header = (const trace_file_header_t*)data_;
+  if (header->magic != TRACE_FILE_MAGIC || header->version != TRACE_FILE_VERSION) {
+    std::cout << "*** error: invalid trace file " << filename << "." << std::endl;
+    exit(-1);
+  }
+  // every record takes at least 3 bytes
+  auto body_size = size_ - sizeof(trace_file_header_t);
+  if (header->count > body_size / 3
+   || (header->count == 0 && body_size != 0)) {
+    corrupt_trace();
+  }
+  remaining_ = header->count;
+  exitcode_ = header->exitcode;
+  cur_ = data_ + sizeof(trace_file_header_t);
+  end_ = data_ + size_;
+}
+
+TraceReader::~TraceReader() {
+  munmap(data_, size_);
+}
+
+pipeline_trace_t* TraceReader::next(TracePool& pool) {
+  if (this->done())
+    return nullptr;
+
+  auto p = cur_;
+  if (end_ - p < 3)
+    corrupt_trace();
+  uint8_t flags = *p++;
+  uint16_t regs = p[0] | (p[1] << 8);
+  p += 2;
+
+  auto fu_type = (flags >> TRACE_SHIFT_FUTYPE) & 0x3;
+  if (fu_type >= NUM_FUS)
+    corrupt_trace();
+
+  Word PC = last_PC_ + 4;
+  if (flags & TRACE_FLAG_PCJUMP) {
+    int64_t delta;
+    p = get_varint(p, end_, &delta);
+    if (p == nullptr)
+      corrupt_trace();
+    PC += delta;
+  }
+
+  int64_t addr_delta = 0;
+  uint8_t mem_size = 0;
+  if (flags & TRACE_FLAG_MEM) {
+    p = get_varint(p, end_, &addr_delta);
+    if (p == nullptr || p == end_)
+      corrupt_trace();
+    mem_size = *p++;
+  }
+
+  // the last record must end the file
+  if (--remaining_ == 0 && p != end_)
+    corrupt_trace();
+
+  last_PC_ = PC;
+
+#ifndef NDEBUG
+  uint32_t uuid = uuid_gen_.get_uuid(PC);
+#else
+  uint64_t uuid = fetch_seq_++;
+#endif
+
+  auto trace = pool.allocate(uuid, PC);
+  trace->wb      = (flags & TRACE_FLAG_WB) != 0;
+  trace->fu_type = FUType(fu_type);
+  trace->fu_op   = (flags >> TRACE_SHIFT_FUOP) & 0x7;
+  trace->rd      = regs & 0x1f;
+  trace->rs1     = (regs >> 5) & 0x1f;
+  trace->rs2     = (regs >> 10) & 0x1f;
+
+  if (flags & TRACE_FLAG_MEM) {
+    trace->mem_addrs = {last_addr_ + addr_delta, mem_size};
+    last_addr_ = trace->mem_addrs.addr;
+  }
+
+  cur_ = p;
+  return trace;
+}
+
+bool TraceReader::check_exit(Word* exitcode, bool riscv_test) const {
+  if (!this->done())
+    return false;
+  *exitcode = riscv_test ? (1 - exitcode_) : exitcode_;
+  return true;
+}
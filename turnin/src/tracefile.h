@@ -0,0 +1,93 @@
+// Copyright 2024 Blaise Tine
+//
+// Licensed under the Apache License;
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <fstream>
+#include <uuid_gen.h>
+#include "types.h"
+
+namespace tinyrv {
+
+struct pipeline_trace_t;
+class TracePool;
+
+// Instruction stream replacing the emulator in the timing model.
+class TraceSource {
+public:
+  virtual ~TraceSource() {}
+
+  // return the next instruction trace, or nullptr at the end of the stream
+  virtual pipeline_trace_t* next(TracePool& pool) = 0;
+
+  virtual bool check_exit(Word* exitcode, bool riscv_test) const = 0;
+};
+
+// Binary instruction trace file.
+// The file starts with a fixed header followed by one variable-length
+// record per instruction:
+//   byte 0   : wb[0], fu_type[2:1], fu_op[5:3], pc_jump[6], mem[7]
+//   byte 1-2 : rd | rs1 << 5 | rs2 << 10
+//   pc_jump  : zigzag varint of PC - (previous PC + 4)
+//   mem      : zigzag varint of addr - previous addr, then one size byte
+struct trace_file_header_t {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t count;
+  uint32_t exitcode;
+  uint32_t reserved;
+};
+
+class TraceWriter {
+public:
+  TraceWriter(const char* filename);
+  ~TraceWriter();
+
+  void write(const pipeline_trace_t& trace);
+
+  void close(Word exitcode);
+
+private:
+  std::ofstream ofs_;
+  uint64_t count_;
+  Word     last_PC_;
+  uint64_t last_addr_;
+};
+
+class TraceReader : public TraceSource {
+public:
+  TraceReader(const char* filename);
+  ~TraceReader();
+
+  pipeline_trace_t* next(TracePool& pool) override;
+
+  bool done() const {
+    return (remaining_ == 0);
+  }
+
+  bool check_exit(Word* exitcode, bool riscv_test) const override;
+
+private:
+  uint8_t* data_;
+  size_t   size_;
+  const uint8_t* cur_;
+  const uint8_t* end_;
+  uint64_t remaining_;
+  Word     exitcode_;
+  Word     last_PC_;
+  uint64_t last_addr_;
+  UUIDGenerator uuid_gen_;
+  uint64_t fetch_seq_;
+};
+
+}
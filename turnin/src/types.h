@@ -36,7 +36,7 @@ typedef std::unordered_map<uint32_t, uint32_t> CSRs;
 
 ///////////////////////////////////////////////////////////////////////////////
 
-enum class RegType {
+enum class RegType : uint8_t {
   None,
   Integer,
   Float
@@ -0,0 +1,43 @@
+#!/bin/bash
+# Steady-state allocation check for the timing model.
+# Runs every workload in every mode on a debug build, whose host stats (-H)
+# report the cycle of the last heap allocation made outside the functional front-end,
+# and flags any workload whose timing model still allocates after warm-up.
+#
+# usage: alloc_check.sh <debug simulator> <warm-up cycles> "<modes>" <workloads...>
+
+SIM=$1
+WARMUP=$2
+MODES=$3
+shift 3
+
+failed=0
+for mode in $MODES; do
+  [ "$mode" == "base" ] && flags="" || flags="$mode"
+  for workload in "$@"; do
+    name=$(basename $workload .hex)
+    log=$($SIM -H $flags $workload | grep -E "PASSED!|^ALLOC:")
+    if ! echo "$log" | grep -q "PASSED!"; then
+      echo "ALLOC-CHECK: $name $mode: failed"
+      failed=1
+      continue
+    fi
+    stats=$(echo "$log" | sed -n 's/^ALLOC: timing_allocs=\([0-9]*\), last_cycle=\([0-9]*\), cycles=\([0-9]*\).*/\1 \2 \3/p')
+    if [ -z "$stats" ]; then
+      echo "ALLOC-CHECK: $name $mode: no allocation report, is $SIM a debug build?"
+      failed=1
+      continue
+    fi
+    read allocs last cycles <<< "$stats"
+    if [ $last -gt $WARMUP ]; then
+      echo "ALLOC-CHECK: $name $mode: allocated at cycle $last of $cycles ($allocs allocations)"
+      failed=1
+    fi
+  done
+done
+
+if [ $failed -ne 0 ]; then
+  echo "ALLOC-CHECK: FAILED"
+  exit 1
+fi
+echo "ALLOC-CHECK: PASSED"
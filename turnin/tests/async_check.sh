@@ -0,0 +1,39 @@
+#!/bin/bash
+# Async emulator check.
+# Runs every workload in every mode with the emulator on the simulation
+# thread and on its own thread (-A); both runs must pass and report the
+# same PERF line.
+#
+# usage: async_check.sh <simulator> <timeout> "<modes>" <workloads...>
+
+SIM=$1
+TIMEOUT=$2
+MODES=$3
+shift 3
+
+failed=0
+for mode in $MODES; do
+  [ "$mode" == "base" ] && flags="" || flags="$mode"
+  for workload in "$@"; do
+    name=$(basename $workload .hex)
+    sync_log=$(timeout $TIMEOUT $SIM -s $flags $workload)
+    async_log=$(timeout $TIMEOUT $SIM -s -A $flags $workload)
+    if ! echo "$sync_log" | grep -q "PASSED!" || ! echo "$async_log" | grep -q "PASSED!"; then
+      echo "ASYNC-CHECK: $name $mode: failed"
+      failed=1
+      continue
+    fi
+    expected=$(echo "$sync_log" | grep "^PERF:")
+    actual=$(echo "$async_log" | grep "^PERF:")
+    if [ "$actual" != "$expected" ]; then
+      echo "ASYNC-CHECK: $name $mode: sync '$expected', async '$actual'"
+      failed=1
+    fi
+  done
+done
+
+if [ $failed -ne 0 ]; then
+  echo "ASYNC-CHECK: FAILED"
+  exit 1
+fi
+echo "ASYNC-CHECK: PASSED"
@@ -0,0 +1,59 @@
+#!/bin/bash
+# Host throughput benchmark for the simulator.
+# Runs every workload in every mode and writes one CSV row per run,
+# then prints the aggregate simulation rate of each mode.
+# A mode that hangs on a workload (timeout) is skipped for the rest.
+#
+# usage: bench.sh <simulator> <output.csv> <timeout> "<modes>" <workloads...>
+
+SIM=$1
+OUT=$2
+TIMEOUT=$3
+MODES=$4
+shift 4
+
+echo "mode,workload,status,instrs,cycles,seconds,instrs_per_sec,cycles_per_sec,peak_rss_kb" > $OUT
+
+for mode in $MODES; do
+  [ "$mode" == "base" ] && flags="" || flags="$mode"
+  skip=0
+  for workload in "$@"; do
+    name=$(basename $workload .hex)
+    if [ $skip -ne 0 ]; then
+      echo "$mode,$name,skipped,,,,,," >> $OUT
+      continue
+    fi
+    log=$(timeout $TIMEOUT $SIM -s -H $flags $workload)
+    rc=$?
+    if [ $rc -eq 124 ]; then
+      echo "$mode,$name,timeout,,,,,," >> $OUT
+      skip=1
+      continue
+    fi
+    status=$(echo "$log" | grep -q "PASSED!" && echo "passed" || echo "failed")
+    echo "$log" | awk -v mode=$mode -v name=$name -v status=$status -F'[=,]' '
+      /^PERF:/ { instrs = $2; cycles = $4 }
+      /^HOST:/ { seconds = $2; rss = $4; sub("KB", "", rss) }
+      END { 
+        ips = (seconds > 0) ? instrs / seconds : 0
+        cps = (seconds > 0) ? cycles / seconds : 0
+        printf "%s,%s,%s,%d,%d,%f,%.0f,%.0f,%d\n", mode, name, status, instrs, cycles, seconds, ips, cps, rss 
+      }' >> $OUT
+  done
+done
+
+# per-mode summary
+awk -F, 'NR > 1 && $3 == "passed" { 
+    instrs[$1] += $4; cycles[$1] += $5; seconds[$1] += $6; runs[$1]++
+    if ($9 > rss[$1]) rss[$1] = $9
+  }
+  NR > 1 && $3 != "passed" { bad[$1]++ }
+  END {
+    for (m in runs) {
+      printf "BENCH: mode=%s, runs=%d, instrs/s=%.0f, cycles/s=%.0f, peak_rss=%dKB\n", 
+        m, runs[m], instrs[m] / seconds[m], cycles[m] / seconds[m], rss[m]
+    }
+    for (m in bad) {
+      if (!(m in runs)) printf "BENCH: mode=%s, no completed runs\n", m
+    }
+  }' $OUT | sort
@@ -0,0 +1,71 @@
+#!/bin/bash
+# Timing regression check for the simulator.
+# Runs every workload in every mode and compares the reported instrs= and
+# cycles= against the golden table; any difference is flagged as drift.
+# With "update" as the first argument, the golden table is rewritten instead.
+#
+# usage: perf_check.sh [update] <simulator> <golden.txt> <timeout> "<modes>" <workloads...>
+
+UPDATE=0
+if [ "$1" == "update" ]; then
+  UPDATE=1
+  shift
+fi
+
+SIM=$1
+GOLDEN=$2
+TIMEOUT=$3
+MODES=$4
+shift 4
+
+if [ $UPDATE -eq 0 ] && [ ! -f $GOLDEN ]; then
+  echo "error: missing golden table $GOLDEN"
+  exit 1
+fi
+
+results=""
+for mode in $MODES; do
+  [ "$mode" == "base" ] && flags="" || flags="$mode"
+  for workload in "$@"; do
+    name=$(basename $workload .hex)
+    log=$(timeout $TIMEOUT $SIM -s $flags $workload)
+    if [ $? -eq 124 ]; then
+      results+="$name $mode timeout"$'\n'
+      continue
+    fi
+    if ! echo "$log" | grep -q "PASSED!"; then
+      results+="$name $mode failed"$'\n'
+      continue
+    fi
+    perf=$(echo "$log" | awk -F'[=,]' '/^PERF:/ { printf "%d %d", $2, $4 }')
+    results+="$name $mode $perf"$'\n'
+  done
+done
+
+if [ $UPDATE -ne 0 ]; then
+  {
+    echo "# workload mode instrs cycles"
+    echo -n "$results"
+  } > $GOLDEN
+  echo "PERF-CHECK: updated $GOLDEN"
+  exit 0
+fi
+
+drift=0
+while read name mode instrs cycles; do
+  expected=$(awk -v n=$name -v m=$mode '$1 == n && $2 == m { print $3, $4 }' $GOLDEN)
+  actual="$instrs${cycles:+ $cycles}"
+  if [ -z "$expected" ]; then
+    echo "PERF-CHECK: $name $mode: no golden entry (got $actual)"
+    drift=1
+  elif [ "$expected" != "$actual" ]; then
+    echo "PERF-CHECK: $name $mode: expected instrs/cycles $expected, got $actual"
+    drift=1
+  fi
+done <<< "$(echo -n "$results")"
+
+if [ $drift -ne 0 ]; then
+  echo "PERF-CHECK: FAILED"
+  exit 1
+fi
+echo "PERF-CHECK: PASSED"
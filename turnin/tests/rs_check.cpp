@@ -0,0 +1,149 @@
+// Copyright 2024 Blaise Tine
+//
+// Licensed under the Apache License;
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Reservation station check.
+// Drives the bitmask ReservationStation and a linear-scan model of the
+// same entries with one random sequence of push, wakeup, select and remove
+// operations, and compares the entries, the selected order and has_ready()
+// after every step. Covers the fixed and the config-sized stations, with
+// sizes below, at and across the 64-entry word boundary.
+
+#include <iostream>
+#include <vector>
+#include <random>
+#include <stdlib.h>
+#include "pipeline.h"
+#include "RS.h"
+
+using namespace tinyrv;
+
+#define CHECK(cond, msg)                                          \
+  do {                                                            \
+    if (!(cond)) {                                                \
+      std::cout << "RS-CHECK: size=" << size << ", seed=" << seed \
+                << ", step=" << step << ": " << msg << std::endl; \
+      return false;                                               \
+    }                                                             \
+  } while (0)
+
+static const int NUM_STEPS = 200000;
+
+template <uint32_t Size>
+static bool check(uint32_t size, uint32_t seed) {
+  // reference model, the state the scoreboard saw before the bitmasks
+  struct ref_t {
+    bool valid;
+    bool running;
+    int rs1_index;
+    int rs2_index;
+  };
+
+  auto is_ready = [](const ref_t& ref) {
+    return ref.valid && !ref.running && ref.rs1_index == -1 && ref.rs2_index == -1;
+  };
+
+  ReservationStation<Size> RS(size);
+  std::vector<ref_t> refs(size, {false, false, -1, -1});
+  std::mt19937 rng(seed);
+  pipeline_trace_t* trace = nullptr;
+
+  for (int step = 0; step < NUM_STEPS; ++step) {
+    switch (rng() % 4) {
+    case 0: {
+      // dispatch, each operand waits on a valid entry or is available
+      if (RS.is_full())
+        break;
+      auto producer = [&]() {
+        int index = rng() % size;
+        return (rng() % 3 != 0 && refs[index].valid) ? index : -1;
+      };
+      int rs1_index = producer();
+      int rs2_index = producer();
+      int index = RS.push(trace, 0, rs1_index, rs2_index);
+      CHECK(!refs[index].valid, "push returned the valid entry " << index);
+      refs[index] = {true, false, rs1_index, rs2_index};
+      break;
+    }
+    case 1: {
+      // writeback of any entry, including free ones
+      int rs_index = rng() % size;
+      RS.wakeup(rs_index);
+      for (auto& ref : refs) {
+        if (!ref.valid)
+          continue;
+        if (ref.rs1_index == rs_index)
+          ref.rs1_index = -1;
+        if (ref.rs2_index == rs_index)
+          ref.rs2_index = -1;
+      }
+      break;
+    }
+    case 2: {
+      // select every ready entry in index order
+      std::vector<int> expected, actual;
+      for (uint32_t i = 0; i < size; ++i) {
+        if (is_ready(refs[i])) {
+          expected.push_back(i);
+          refs[i].running = true;
+        }
+      }
+      for (int i = RS.find_ready(0); i != -1; i = RS.find_ready(i + 1)) {
+        actual.push_back(i);
+        RS.set_running(i);
+      }
+      CHECK(actual == expected, "selected " << actual.size() << " entries, expected " << expected.size());
+      break;
+    }
+    case 3: {
+      // commit or flush of a random entry
+      uint32_t index = rng() % size;
+      if (!refs[index].valid)
+        break;
+      RS.remove(index);
+      refs[index].valid = false;
+      break;
+    }
+    }
+
+    bool any_ready = false;
+    for (uint32_t i = 0; i < size; ++i) {
+      auto& entry = RS[i];
+      auto& ref = refs[i];
+      CHECK(entry.valid == ref.valid, "entry " << i << " valid=" << entry.valid);
+      if (!entry.valid)
+        continue;
+      CHECK(entry.running == ref.running, "entry " << i << " running=" << entry.running);
+      CHECK(entry.rs1_index == ref.rs1_index, "entry " << i << " rs1=" << entry.rs1_index << ", expected " << ref.rs1_index);
+      CHECK(entry.rs2_index == ref.rs2_index, "entry " << i << " rs2=" << entry.rs2_index << ", expected " << ref.rs2_index);
+      any_ready |= is_ready(ref);
+    }
+    CHECK(RS.has_ready() == any_ready, "has_ready=" << RS.has_ready());
+  }
+  return true;
+}
+
+int main() {
+  bool passed = true;
+  passed &= check<NUM_RSS>(NUM_RSS, 1);
+  passed &= check<64>(64, 2);
+  passed &= check<256>(256, 3);
+  passed &= check<0>(NUM_RSS, 4);
+  passed &= check<0>(100, 5);
+  passed &= check<0>(200, 6);
+  if (!passed) {
+    std::cout << "RS-CHECK: FAILED" << std::endl;
+    return 1;
+  }
+  std::cout << "RS-CHECK: PASSED" << std::endl;
+  return 0;
+}
@@ -0,0 +1,50 @@
+#!/bin/bash
+# Snapshot and restore check.
+# Runs every workload in every mode with the simulator fast-forwarding it,
+# then with the sweep driver, which snapshots each workload at the same
+# point and runs every mode twice from restored copies of that snapshot;
+# every restored run must report the same instrs= and cycles= as the
+# uninterrupted one.
+#
+# usage: snapshot_check.sh <simulator> <sweep driver> <fast-forward instrs> <timeout> "<modes>" <workloads...>
+
+SIM=$1
+SWEEP=$2
+FF=$3
+TIMEOUT=$4
+MODES=$5
+shift 5
+
+configs=""
+for mode in $MODES; do
+  [ "$mode" == "base" ] && config="base" || config="${mode#-}"
+  configs+="${configs:+,}$config,$config"
+done
+
+failed=0
+for workload in "$@"; do
+  name=$(basename $workload .hex)
+  rows=$(timeout $TIMEOUT $SWEEP -F $FF -c $configs $workload | grep "^$workload,")
+  for mode in $MODES; do
+    [ "$mode" == "base" ] && flags="" || flags="$mode"
+    [ "$mode" == "base" ] && config="base" || config="${mode#-}"
+    log=$(timeout $TIMEOUT $SIM -s $flags -F $FF $workload)
+    if ! echo "$log" | grep -q "PASSED!"; then
+      echo "SNAPSHOT-CHECK: $name $mode: failed"
+      failed=1
+      continue
+    fi
+    expected=$(echo "$log" | awk -F'[=,]' '/^PERF:/ { printf "%d %d", $2, $4 }')
+    actual=$(echo "$rows" | awk -F, -v c=$config '$2 == c { printf "%s%s %s %s", sep, $3, $4, $5; sep = "/" }')
+    if [ "$actual" != "passed $expected/passed $expected" ]; then
+      echo "SNAPSHOT-CHECK: $name $mode: expected instrs/cycles $expected, restored runs got ${actual:-nothing}"
+      failed=1
+    fi
+  done
+done
+
+if [ $failed -ne 0 ]; then
+  echo "SNAPSHOT-CHECK: FAILED"
+  exit 1
+fi
+echo "SNAPSHOT-CHECK: PASSED"